@@ -0,0 +1,550 @@
+// This file is placed under public domain.
+// Measures LoveToken on generated corpora. Usage: bench [megabytes] [repetitions]
+// Prints one tab-separated line per corpus and function, so runs from
+// different versions can be diffed. MB/s is always the whole corpus over
+// the time taken. lt.c should be compiled with -Dmalloc=LT_BenchMalloc
+// -Drealloc=LT_BenchReAlloc to count allocations (make bench does this).
+#define _POSIX_C_SOURCE 200809L
+#include "lt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <sys/resource.h>
+#endif
+
+typedef struct
+{
+	char *data;
+	size_t len, cap;
+} Corpus;
+
+typedef struct
+{
+	size_t tokens;
+	double seconds;
+	size_t allocs;
+	long peakKB;
+} Result;
+
+static size_t allocCount;
+static unsigned rngState = 2463534242u;
+
+void *LT_BenchMalloc(size_t size)
+{
+	allocCount++;
+	return malloc(size);
+}
+
+void *LT_BenchReAlloc(void *ptr, size_t size)
+{
+	allocCount++;
+	return realloc(ptr, size);
+}
+
+/*
+ * Corpora
+ */
+
+static unsigned Random(unsigned n)
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState % n;
+}
+
+static void Put(Corpus *c, const char *str, size_t len)
+{
+	if(c->len + len + 1 > c->cap)
+	{
+		c->cap = (c->len + len + 1) * 2;
+		c->data = realloc(c->data, c->cap);
+	}
+	
+	memcpy(c->data + c->len, str, len);
+	c->len += len;
+	c->data[c->len] = '\0';
+}
+
+static void PutS(Corpus *c, const char *str)
+{
+	Put(c, str, strlen(str));
+}
+
+static void PutIdent(Corpus *c)
+{
+	static const char first[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+	static const char rest[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+	char buf[32];
+	unsigned len = 1 + Random(12), i;
+	
+	buf[0] = first[Random(sizeof(first) - 1)];
+	
+	for(i = 1; i < len; i++)
+	{
+		buf[i] = rest[Random(sizeof(rest) - 1)];
+	}
+	
+	Put(c, buf, len);
+}
+
+static void PutWords(Corpus *c, unsigned count)
+{
+	unsigned i;
+	
+	for(i = 0; i < count; i++)
+	{
+		PutS(c, " ");
+		PutIdent(c);
+	}
+}
+
+// Code with mostly identifiers and operators.
+static void GenIdents(Corpus *c)
+{
+	static const char *ops[] = { " = ", " + ", " - ", " * ", " == ", " && ", " < ", ", ", "->", "." };
+	unsigned n = Random(6), i;
+	char num[16];
+	
+	PutS(c, "\t");
+	PutIdent(c);
+	PutS(c, " = ");
+	PutIdent(c);
+	PutS(c, "(");
+	
+	for(i = 0; i < n; i++)
+	{
+		PutIdent(c);
+		PutS(c, ops[Random(10)]);
+	}
+	
+	sprintf(num, "%u", Random(1000));
+	PutS(c, num);
+	PutS(c, ");\n");
+}
+
+// Long string literals without escapes.
+static void GenStrings(Corpus *c)
+{
+	static const char chars[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ,.!?0123456789";
+	unsigned len = 100 + Random(1900), i;
+	char buf[2048];
+	
+	for(i = 0; i < len; i++)
+	{
+		buf[i] = chars[Random(sizeof(chars) - 1)];
+	}
+	
+	PutS(c, "\"");
+	Put(c, buf, len);
+	PutS(c, "\"\n");
+}
+
+// Tables of decimal, hex and fractional numbers.
+static void GenNumbers(Corpus *c)
+{
+	char buf[32];
+	unsigned i;
+	
+	for(i = 0; i < 8; i++)
+	{
+		switch(Random(3))
+		{
+		case 0: sprintf(buf, "%u, ", Random(100000)); break;
+		case 1: sprintf(buf, "0x%X, ", Random(0x10000)); break;
+		case 2: sprintf(buf, "%u.%u, ", Random(1000), Random(100000)); break;
+		}
+		
+		PutS(c, buf);
+	}
+	
+	PutS(c, "\n");
+}
+
+// Prose in line and block comments, with a little code between.
+static void GenComments(Corpus *c)
+{
+	switch(Random(3))
+	{
+	case 0:
+		PutS(c, "// ");
+		PutWords(c, 4 + Random(10));
+		PutS(c, "\n");
+		break;
+	case 1:
+		PutS(c, "/*");
+		PutWords(c, 8 + Random(30));
+		PutS(c, "\n  ");
+		PutWords(c, 8 + Random(30));
+		PutS(c, " */\n");
+		break;
+	case 2:
+		GenIdents(c);
+		break;
+	}
+}
+
+// Short strings that are mostly escape sequences.
+static void GenEscapes(Corpus *c)
+{
+	static const char *escapes[] = { "\\n", "\\t", "\\\\", "\\\"", "\\'", "\\x41", "\\r", "\\a" };
+	unsigned n = 4 + Random(40), i;
+	
+	PutS(c, "\"");
+	
+	for(i = 0; i < n; i++)
+	{
+		if(Random(2))
+		{
+			PutS(c, escapes[Random(8)]);
+		}
+		else
+		{
+			PutIdent(c);
+		}
+	}
+	
+	PutS(c, "\"\n");
+}
+
+static const struct
+{
+	const char *name;
+	void (*gen)(Corpus *c);
+} corpora[] = {
+	{ "idents",   GenIdents },
+	{ "strings",  GenStrings },
+	{ "numbers",  GenNumbers },
+	{ "comments", GenComments },
+	{ "escapes",  GenEscapes }
+};
+
+/*
+ * Measuring
+ */
+
+static double Now(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+// Resets the peak resident set size where the OS lets us, so each run gets
+// its own. Elsewhere this is the peak of the whole process so far.
+static void ResetPeak(void)
+{
+#ifdef __linux__
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+	
+	if(f != NULL)
+	{
+		fputs("5", f);
+		fclose(f);
+	}
+#endif
+}
+
+static long PeakKB(void)
+{
+#ifdef __linux__
+	FILE *f = fopen("/proc/self/status", "r");
+	char line[256];
+	long kb = -1;
+	
+	if(f != NULL)
+	{
+		while(fgets(line, sizeof(line), f) != NULL)
+		{
+			if(strncmp(line, "VmHWM:", 6) == 0)
+			{
+				kb = atol(line + 6);
+				break;
+			}
+		}
+		
+		fclose(f);
+	}
+	
+	if(kb >= 0)
+	{
+		return kb;
+	}
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+	{
+		struct rusage ru;
+		
+		getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+		return ru.ru_maxrss / 1024;
+#else
+		return ru.ru_maxrss;
+#endif
+	}
+#else
+	return -1;
+#endif
+}
+
+// Strings are released every so often, like a parser that's done with
+// each statement would.
+#define RELEASE_EVERY 1024
+
+// How many tokens LT_GetTokens reads at a time.
+#define BATCH 256
+
+// A memLimit that's never reached, so only checking it is measured.
+#define MEM_LIMIT ((size_t)1 << 30)
+
+static size_t RunGetToken(const Corpus *c)
+{
+	size_t tokens = 0;
+	LT_Token tk;
+	
+	LT_OpenMemory(c->data, c->len);
+	
+	do
+	{
+		tk = LT_GetToken();
+		
+		if(++tokens % RELEASE_EVERY == 0)
+		{
+			LT_ReleaseStrings();
+		}
+	}
+	while(tk.kind != TOK_EOF);
+	
+	LT_CloseFile();
+	LT_ReleaseStrings();
+	
+	return tokens;
+}
+
+static size_t RunGetTokens(const Corpus *c)
+{
+	static LT_Token batch[BATCH];
+	size_t tokens = 0, n;
+	
+	LT_OpenMemory(c->data, c->len);
+	
+	do
+	{
+		n = LT_GetTokens(batch, BATCH);
+		tokens += n;
+		
+		if(tokens / RELEASE_EVERY != (tokens - n) / RELEASE_EVERY)
+		{
+			LT_ReleaseStrings();
+		}
+	}
+	while(batch[n - 1].kind != TOK_EOF);
+	
+	LT_CloseFile();
+	LT_ReleaseStrings();
+	
+	return tokens;
+}
+
+// Runs another function under MEM_LIMIT. LT_GetToken sets a point to
+// recover to for each token, and LT_GetTokens one for each batch.
+static size_t RunLimited(const Corpus *c, size_t (*run)(const Corpus *c))
+{
+	LT_Config cfg = { 0 };
+	size_t tokens;
+	
+	cfg.escapeChars = LT_TRUE;
+	cfg.memLimit = MEM_LIMIT;
+	LT_SetConfig(cfg);
+	
+	tokens = run(c);
+	
+	cfg.memLimit = 0;
+	LT_SetConfig(cfg);
+	
+	return tokens;
+}
+
+static size_t RunGetTokenLimited(const Corpus *c)
+{
+	return RunLimited(c, RunGetToken);
+}
+
+static size_t RunGetTokensLimited(const Corpus *c)
+{
+	return RunLimited(c, RunGetTokens);
+}
+
+// LT_GetToken with skipComments, so comments never become tokens.
+static size_t RunSkipComments(const Corpus *c)
+{
+	LT_Config cfg = { 0 };
+	size_t tokens;
+	
+	cfg.escapeChars = LT_TRUE;
+	cfg.skipComments = LT_TRUE;
+	LT_SetConfig(cfg);
+	
+	tokens = RunGetToken(c);
+	
+	cfg.skipComments = LT_FALSE;
+	LT_SetConfig(cfg);
+	
+	return tokens;
+}
+
+static size_t RunReadLiteral(const Corpus *c)
+{
+	size_t lines = 0, i;
+	
+	// Every corpus line ends in '\n', and each call reads one line.
+	for(i = 0; i < c->len; i++)
+	{
+		lines += c->data[i] == '\n';
+	}
+	
+	LT_OpenMemory(c->data, c->len);
+	
+	for(i = 1; i <= lines; i++)
+	{
+		LT_ReadLiteral();
+		
+		if(i % RELEASE_EVERY == 0)
+		{
+			LT_ReleaseStrings();
+		}
+	}
+	
+	LT_CloseFile();
+	LT_ReleaseStrings();
+	
+	return lines;
+}
+
+// Skips every run of whitespace in the corpus, jumping over the text
+// between them with LT_SetPos.
+static size_t RunSkipWhite(const Corpus *c)
+{
+	size_t runs = 0, i;
+	
+	LT_OpenMemory(c->data, c->len);
+	
+	for(i = 0; i < c->len; i++)
+	{
+		char ch = c->data[i];
+		
+		if(ch == ' ' || ch == '\t' || ch == '\n')
+		{
+			LT_SetPos((int)i);
+			LT_SkipWhite();
+			runs++;
+			
+			while(i + 1 < c->len && (c->data[i + 1] == ' ' || c->data[i + 1] == '\t' || c->data[i + 1] == '\n'))
+			{
+				i++;
+			}
+		}
+	}
+	
+	LT_CloseFile();
+	
+	return runs;
+}
+
+static const struct
+{
+	const char *name;
+	size_t (*run)(const Corpus *c);
+} functions[] = {
+	{ "LT_GetToken",            RunGetToken },
+	{ "LT_GetTokens",           RunGetTokens },
+	{ "memLimit",               RunGetTokenLimited },
+	{ "LT_GetTokens, memLimit", RunGetTokensLimited },
+	{ "skipComments",           RunSkipComments },
+	{ "LT_ReadLiteral",         RunReadLiteral },
+	{ "LT_SkipWhite",           RunSkipWhite }
+};
+
+// Keeps the fastest of several runs.
+static Result Measure(size_t (*run)(const Corpus *c), const Corpus *c, unsigned reps)
+{
+	Result best = { 0 };
+	unsigned r;
+	
+	for(r = 0; r < reps; r++)
+	{
+		size_t allocs;
+		double start;
+		Result res;
+		
+		ResetPeak();
+		allocs = allocCount;
+		start = Now();
+		res.tokens = run(c);
+		res.seconds = Now() - start;
+		res.allocs = allocCount - allocs;
+		res.peakKB = PeakKB();
+		
+		if(r == 0 || res.seconds < best.seconds)
+		{
+			best = res;
+		}
+	}
+	
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	size_t megabytes = argc > 1 ? (size_t)atoi(argv[1]) : 8;
+	unsigned reps = argc > 2 ? (unsigned)atoi(argv[2]) : 5;
+	LT_Config initCfg = { 0 };
+	size_t i, j;
+	
+	if(megabytes == 0 || reps == 0)
+	{
+		fprintf(stderr, "usage: %s [megabytes] [repetitions]\n", argv[0]);
+		return 1;
+	}
+	
+	initCfg.escapeChars = LT_TRUE;
+	LT_Init(initCfg);
+	
+	printf("corpus\tfunction\tbytes\ttokens\tseconds\tMB/s\ttokens/s\tallocs/token\tpeak_rss_kb\n");
+	
+	for(i = 0; i < sizeof(corpora) / sizeof(*corpora); i++)
+	{
+		Corpus c = { 0 };
+		
+		while(c.len < megabytes << 20)
+		{
+			corpora[i].gen(&c);
+		}
+		
+		for(j = 0; j < sizeof(functions) / sizeof(*functions); j++)
+		{
+			Result res = Measure(functions[j].run, &c, reps);
+			
+			printf("%s\t%s\t%lu\t%lu\t%.4f\t%.1f\t%.0f\t%.4f\t%ld\n",
+				corpora[i].name, functions[j].name,
+				(unsigned long)c.len, (unsigned long)res.tokens, res.seconds,
+				c.len / 1048576.0 / res.seconds, res.tokens / res.seconds,
+				(double)res.allocs / res.tokens, res.peakKB);
+			fflush(stdout);
+		}
+		
+		free(c.data);
+	}
+	
+	LT_Quit();
+	
+	return 0;
+}
@@ -39,6 +39,15 @@ typedef struct
 	const char *toCode;
 	const char *stringChars;
 	const char *charChars;
+	LT_BOOL mapFiles;
+	LT_BOOL spanTokens;
+	LT_BOOL internIdents;
+	const char *const *keywords;
+	LT_BOOL parseNumbers;
+	LT_BOOL lazyEscapes;
+	size_t memLimit;
+	LT_BOOL skipComments;
+	LT_BOOL commentSpans;
 } LT_Config;
 
 typedef struct
@@ -47,6 +56,16 @@ typedef struct
 	char *string;
 	int strlen;
 	int pos;
+	int spanPos;
+	unsigned spanLen;
+	int kind;
+	int symbol;
+	int numType;
+	unsigned suffixLen;
+	unsigned long long intValue;
+	double floatValue;
+	LT_BOOL hasEscapes;
+	int line, col;
 } LT_Token;
 
 typedef struct
@@ -55,30 +74,198 @@ typedef struct
 	const char *str;
 } LT_AssertInfo;
 
+typedef struct
+{
+	int code;
+	const char *func;
+	long offset;
+	int line, col;
+	long arg;
+	const char *detail;
+} LT_ErrorInfo;
+
+typedef struct
+{
+	size_t tokens[51]; // TOK_Keywrd + 1
+	size_t bytes;
+	size_t allocs;
+	size_t allocBytes;
+	size_t conversions;
+	size_t strGrowths;
+	size_t asserts;
+} LT_Stats;
+
+typedef struct LT_Context_s LT_Context;
+typedef struct LT_Document_s LT_Document;
+
 void LT_Init(LT_Config initCfg);
 void LT_SetConfig(LT_Config newCfg);
 void LT_Quit(void);
+void LT_ReleaseStrings(void);
 
 LT_BOOL LT_Assert(LT_BOOL assertion, const char *fmt, ...);
 LT_AssertInfo LT_CheckAssert(void);
+size_t LT_GetErrors(LT_ErrorInfo *out, size_t max);
+void LT_ClearErrors(void);
+size_t LT_FormatError(const LT_ErrorInfo *err, char *buf, size_t size);
 
 LT_BOOL LT_OpenFile(const char *filePath);
+LT_BOOL LT_OpenMemory(const char *data, size_t size);
+LT_BOOL LT_Feed(const char *data, size_t len, LT_BOOL isLast);
+LT_BOOL LT_NeedsInput(void);
 void LT_SetPos(int newPos);
+LT_BOOL LT_OffsetToLineCol(long offset, int *line, int *col);
 void LT_CloseFile(void);
 
 char *LT_ReadNumber(void);
 void LT_ReadString(LT_Token *tk, char term);
 char *LT_Escaper(char *str, size_t pos, char escape);
 LT_Token LT_GetToken(void);
+size_t LT_GetTokens(LT_Token *out, size_t max);
+LT_Token *LT_TokenizeParallel(unsigned threads, size_t *count);
+LT_BOOL LT_SaveTokens(const char *cachePath, const LT_Token *tokens, size_t count);
+LT_Token *LT_LoadTokens(const char *cachePath, size_t *count);
 char *LT_ReadLiteral(void);
 void LT_SkipWhite(void);
 void LT_SkipWhite2(void);
+const char *LT_GetSpan(const LT_Token *tk);
+char *LT_TokenString(LT_Token *tk);
+char *LT_DecodeString(LT_Token *tk);
+int LT_Intern(const char *str);
+const char *LT_SymbolName(int symbol);
+LT_Stats LT_GetStats(void);
+void LT_ResetStats(void);
+LT_BOOL LT_StartTrace(size_t maxEvents);
+void LT_StopTrace(void);
+LT_BOOL LT_DumpTrace(const char *filePath);
+
+LT_Context *LT_CreateContext(LT_Config initCfg);
+void LT_SetConfigCtx(LT_Context *ctx, LT_Config newCfg);
+void LT_DestroyContext(LT_Context *ctx);
+void LT_ReleaseStringsCtx(LT_Context *ctx);
+
+LT_BOOL LT_AssertCtx(LT_Context *ctx, LT_BOOL assertion, const char *fmt, ...);
+LT_AssertInfo LT_CheckAssertCtx(LT_Context *ctx);
+size_t LT_GetErrorsCtx(LT_Context *ctx, LT_ErrorInfo *out, size_t max);
+void LT_ClearErrorsCtx(LT_Context *ctx);
+
+LT_BOOL LT_OpenFileCtx(LT_Context *ctx, const char *filePath);
+LT_BOOL LT_OpenMemoryCtx(LT_Context *ctx, const char *data, size_t size);
+LT_BOOL LT_FeedCtx(LT_Context *ctx, const char *data, size_t len, LT_BOOL isLast);
+LT_BOOL LT_NeedsInputCtx(LT_Context *ctx);
+void LT_SetPosCtx(LT_Context *ctx, int newPos);
+LT_BOOL LT_OffsetToLineColCtx(LT_Context *ctx, long offset, int *line, int *col);
+void LT_CloseFileCtx(LT_Context *ctx);
+
+char *LT_ReadNumberCtx(LT_Context *ctx);
+void LT_ReadStringCtx(LT_Context *ctx, LT_Token *tk, char term);
+char *LT_EscaperCtx(LT_Context *ctx, char *str, size_t pos, char escape);
+LT_Token LT_GetTokenCtx(LT_Context *ctx);
+size_t LT_GetTokensCtx(LT_Context *ctx, LT_Token *out, size_t max);
+LT_Token *LT_TokenizeParallelCtx(LT_Context *ctx, unsigned threads, size_t *count);
+LT_BOOL LT_SaveTokensCtx(LT_Context *ctx, const char *cachePath, const LT_Token *tokens, size_t count);
+LT_Token *LT_LoadTokensCtx(LT_Context *ctx, const char *cachePath, size_t *count);
+char *LT_ReadLiteralCtx(LT_Context *ctx);
+void LT_SkipWhiteCtx(LT_Context *ctx);
+void LT_SkipWhite2Ctx(LT_Context *ctx);
+const char *LT_GetSpanCtx(LT_Context *ctx, const LT_Token *tk);
+char *LT_TokenStringCtx(LT_Context *ctx, LT_Token *tk);
+char *LT_DecodeStringCtx(LT_Context *ctx, LT_Token *tk);
+int LT_InternCtx(LT_Context *ctx, const char *str);
+const char *LT_SymbolNameCtx(LT_Context *ctx, int symbol);
+LT_Stats LT_GetStatsCtx(LT_Context *ctx);
+void LT_ResetStatsCtx(LT_Context *ctx);
+LT_BOOL LT_StartTraceCtx(LT_Context *ctx, size_t maxEvents);
+void LT_StopTraceCtx(LT_Context *ctx);
+LT_BOOL LT_DumpTraceCtx(LT_Context *ctx, const char *filePath);
+
+LT_Document *LT_CreateDocument(LT_Config cfg, const char *text, size_t len);
+void LT_DestroyDocument(LT_Document *doc);
+LT_BOOL LT_ApplyEdit(LT_Document *doc, size_t offset, size_t removed, const char *inserted, size_t insertedLen);
+const LT_Token *LT_DocumentTokens(LT_Document *doc, size_t *count);
+const char *LT_DocumentText(LT_Document *doc, size_t *len);
+LT_Context *LT_DocumentContext(LT_Document *doc);
 ]])
 
+-- Token kinds, in the same order as the TOK_* enum in lt.h.
+-- tokenizer.kinds maps names to kinds, tokenizer.names maps kinds to names.
+local tokenNames = {
+	"TOK_Colon",   "TOK_Comma", "TOK_Div",    "TOK_Mod",    "TOK_Mul",    "TOK_Query",
+	"TOK_BraceO",  "TOK_BraceC","TOK_BrackO", "TOK_BrackC", "TOK_ParenO", "TOK_ParenC",
+	"TOK_LnEnd",   "TOK_Add2",  "TOK_Add",    "TOK_And2",   "TOK_And",    "TOK_CmpGE",
+	"TOK_ShR",     "TOK_CmpGT", "TOK_CmpLE",  "TOK_ShL",    "TOK_CmpNE",  "TOK_CmpLT",
+	"TOK_CmpEQ",   "TOK_Equal", "TOK_Not",    "TOK_OrI2",   "TOK_OrI",    "TOK_OrX2",
+	"TOK_OrX",     "TOK_Sub2",  "TOK_Sub",    "TOK_String", "TOK_Charac", "TOK_Number",
+	"TOK_Identi",  "TOK_EOF",   "TOK_ChrSeq", "TOK_Comment","TOK_Period", "TOK_Arrow",
+	"TOK_Sigil",   "TOK_Hash",  "TOK_BlkCmtO","TOK_BlkCmtC","TOK_Exp",    "TOK_NstCmtO",
+	"TOK_NstCmtC", "TOK_Semicl", "TOK_Keywrd"
+}
+
+tokenizer.kinds = {}
+tokenizer.names = {}
+
+for i, name in ipairs(tokenNames) do
+	tokenizer.kinds[name] = i - 1
+	tokenizer.names[i - 1] = name
+end
+
 local pReturn
+local memSource -- keeps the string given to openMemory alive while it's being read
+local tokenBuf, tokenBufSize = nil, 0
+
+local function toToken(tk, ctx)
+	local lt = {}
+	if (tk.string == nil and tk.hasEscapes ~= 0) then
+		-- Strings left with their escapes in them (lazyEscapes) get decoded here.
+		if (ctx) then
+			loveToken.LT_DecodeStringCtx(ctx, tk)
+		else
+			loveToken.LT_DecodeString(tk)
+		end
+	end
+	lt.kind = tk.kind
+	lt.token = lt.kind >= tokenizer.kinds.TOK_Keywrd and ffi.string(tk.token) or tokenizer.names[lt.kind]
+	lt.string = tk.string
+	lt.strlen = tk.strlen
+	lt.pos = tk.pos
+	lt.line = tk.line
+	lt.col = tk.col
+	lt.symbol = tk.symbol
+	-- With parseNumbers, numType is 1 for integers, 2 for floats and 3 for bad numbers.
+	if (tk.numType ~= 0) then
+		lt.numType = tk.numType
+		lt.value = tk.numType == 1 and tk.intValue or tk.floatValue
+		lt.suffixLen = tk.suffixLen
+	end
+	if (tk.string ~= nil) then
+		lt.string = ffi.string(tk.string)
+	elseif (tk.spanPos >= 0) then
+		local span = ctx and loveToken.LT_GetSpanCtx(ctx, tk) or loveToken.LT_GetSpan(tk)
+		-- Comments read through stdio (commentSpans) have nothing to point at.
+		if (span ~= nil) then
+			lt.string = ffi.string(span, tk.spanLen)
+		end
+	end
+	return lt
+end
+
+-- Configs may give keywords as a list of strings, the nth of which is lexed
+-- as kind TOK_Keywrd + n - 1 with the keyword as its token. LT_Init copies
+-- them, so the array made here only has to last until then.
+local function toConfig(initInfo)
+	if (type(initInfo) ~= "table" or type(initInfo.keywords) ~= "table") then
+		return initInfo
+	end
+	local cfg = {}
+	for k, v in pairs(initInfo) do
+		cfg[k] = v
+	end
+	cfg.keywords = ffi.new("const char *[?]", #initInfo.keywords + 1, initInfo.keywords)
+	return cfg
+end
 
 function tokenizer:init(initInfo, filePath)
-	loveToken.LT_Init(initInfo)
+	loveToken.LT_Init(toConfig(initInfo))
 	loveToken.LT_OpenFile(filePath)
 end
 
@@ -96,14 +283,69 @@ function tokenizer:checkError()
 	end
 end
 
+-- Returns the latest errors (up to 16) since the last clearErrors, oldest
+-- first, without having to check after every call.
+function tokenizer:getErrors()
+	local errs = ffi.new("LT_ErrorInfo[16]")
+	local buf = ffi.new("char[512]")
+	local out = {}
+	for i = 0, tonumber(loveToken.LT_GetErrors(errs, 16)) - 1 do
+		local e = errs[i]
+		loveToken.LT_FormatError(e, buf, 512)
+		out[i + 1] = {
+			code = e.code,
+			offset = tonumber(e.offset),
+			line = e.line,
+			col = e.col,
+			arg = tonumber(e.arg),
+			message = ffi.string(buf)
+		}
+	end
+	return out
+end
+
+function tokenizer:clearErrors()
+	loveToken.LT_ClearErrors()
+end
+
 function tokenizer:openFile(filePath)
 	pReturn = loveToken.LT_OpenFile(filePath)
 	tokenizer:checkError()
 	return pReturn
 end
 
+function tokenizer:openMemory(data)
+	memSource = data
+	pReturn = loveToken.LT_OpenMemory(data, #data)
+	tokenizer:checkError()
+	return pReturn
+end
+
+-- Adds data to a stream, starting one if needed. The data is copied.
+-- getToken returns TOK_EOF with needsInput() true when it needs more.
+function tokenizer:feed(data, isLast)
+	memSource = nil
+	pReturn = loveToken.LT_Feed(data, #data, isLast and 1 or 0)
+	tokenizer:checkError()
+	return pReturn
+end
+
+function tokenizer:needsInput()
+	return loveToken.LT_NeedsInput() ~= 0
+end
+
+-- Returns the line and column (both from 1) of an offset that's been read.
+function tokenizer:offsetToLineCol(offset)
+	local line, col = ffi.new("int[1]"), ffi.new("int[1]")
+	if (loveToken.LT_OffsetToLineCol(offset, line, col) == 0) then
+		return nil
+	end
+	return line[0], col[0]
+end
+
 function tokenizer:closeFile()
 	loveToken.LT_CloseFile()
+	memSource = nil
 end
 
 function tokenizer:quit()
@@ -111,6 +353,10 @@ function tokenizer:quit()
 	loveToken.LT_Quit()
 end
 
+function tokenizer:releaseStrings()
+	loveToken.LT_ReleaseStrings()
+end
+
 function tokenizer:readNumber()
 	pReturn = loveToken.LT_ReadNumber()
 	tokenizer:checkError()
@@ -132,15 +378,133 @@ end
 function tokenizer:getToken()
 	pReturn = loveToken.LT_GetToken()
 	tokenizer:checkError()
-	local lt = {}
-	lt.token = ffi.string(pReturn.token)
-	lt.string = pReturn.string
-	lt.strlen = pReturn.strlen
-	lt.pos = pReturn.pos
-	if (pReturn.string ~= nil) then
-		lt.string = ffi.string(pReturn.string)
+	return toToken(pReturn)
+end
+
+-- Reads up to max tokens in one call. The last one is TOK_EOF once the end is reached.
+function tokenizer:getTokens(max)
+	if (tokenBufSize < max) then
+		tokenBuf = ffi.new("LT_Token[?]", max)
+		tokenBufSize = max
 	end
-	return lt
+	local n = tonumber(loveToken.LT_GetTokens(tokenBuf, max))
+	tokenizer:checkError()
+	local tks = {}
+	for i = 0, n - 1 do
+		tks[i + 1] = toToken(tokenBuf[i])
+	end
+	return tks
+end
+
+-- Reads every remaining token of a memory or mapped source on several threads.
+-- threads can be nil or 0 to use one per CPU. The last token is TOK_EOF.
+function tokenizer:tokenizeParallel(threads)
+	local count = ffi.new("size_t[1]")
+	local out = loveToken.LT_TokenizeParallel(threads or 0, count)
+	tokenizer:checkError()
+	local tks = {}
+	for i = 0, tonumber(count[0]) - 1 do
+		tks[i + 1] = toToken(out[i])
+	end
+	return tks
+end
+
+-- Like tokenizeParallel, but takes the tokens from the cache at cachePath when
+-- it was made from this source with this config, and otherwise lexes them and
+-- writes the cache for next time.
+function tokenizer:tokenizeCached(cachePath, threads)
+	local count = ffi.new("size_t[1]")
+	local out = loveToken.LT_LoadTokens(cachePath, count)
+	tokenizer:checkError()
+	if out == nil then
+		out = loveToken.LT_TokenizeParallel(threads or 0, count)
+		tokenizer:checkError()
+		loveToken.LT_SaveTokens(cachePath, out, count[0])
+		tokenizer:checkError()
+	end
+	local tks = {}
+	for i = 0, tonumber(count[0]) - 1 do
+		tks[i + 1] = toToken(out[i])
+	end
+	return tks
+end
+
+-- Documents keep their text and tokens, and only re-lex around each edit.
+local Document = {}
+Document.__index = Document
+
+function tokenizer:createDocument(cfg, text)
+	local doc = loveToken.LT_CreateDocument(toConfig(cfg), text, #text)
+	return setmetatable({ handle = ffi.gc(doc, loveToken.LT_DestroyDocument) }, Document)
+end
+
+-- Replaces removed bytes at offset (counting from 0) with inserted.
+function Document:applyEdit(offset, removed, inserted)
+	inserted = inserted or ""
+	return loveToken.LT_ApplyEdit(self.handle, offset, removed, inserted, #inserted) ~= 0
+end
+
+function Document:text()
+	local len = ffi.new("size_t[1]")
+	local text = loveToken.LT_DocumentText(self.handle, len)
+	return ffi.string(text, len[0])
+end
+
+function Document:tokens()
+	local count = ffi.new("size_t[1]")
+	local tks = loveToken.LT_DocumentTokens(self.handle, count)
+	local ctx = loveToken.LT_DocumentContext(self.handle)
+	local out = {}
+	for i = 0, tonumber(count[0]) - 1 do
+		out[i + 1] = toToken(tks[i], ctx)
+	end
+	return out
+end
+
+-- With internIdents, identifiers with the same text have the same symbol.
+function tokenizer:intern(str)
+	return loveToken.LT_Intern(str)
+end
+
+function tokenizer:symbolName(symbol)
+	local name = loveToken.LT_SymbolName(symbol)
+	return name ~= nil and ffi.string(name) or nil
+end
+
+-- Returns the lexer's counters, with tokens counted by kind name.
+function tokenizer:getStats()
+	local stats = loveToken.LT_GetStats()
+	local out = { tokens = {} }
+	for kind, name in pairs(tokenizer.names) do
+		out.tokens[name] = tonumber(stats.tokens[kind])
+	end
+	out.bytes = tonumber(stats.bytes)
+	out.allocs = tonumber(stats.allocs)
+	out.allocBytes = tonumber(stats.allocBytes)
+	out.conversions = tonumber(stats.conversions)
+	out.strGrowths = tonumber(stats.strGrowths)
+	out.asserts = tonumber(stats.asserts)
+	return out
+end
+
+function tokenizer:resetStats()
+	loveToken.LT_ResetStats()
+end
+
+-- Records lexer events into a ring of maxEvents (default 16384) until
+-- stopTrace. dumpTrace writes them as JSON for chrome://tracing or Perfetto.
+function tokenizer:startTrace(maxEvents)
+	return loveToken.LT_StartTrace(maxEvents or 0) ~= 0
+end
+
+function tokenizer:stopTrace()
+	loveToken.LT_StopTrace()
+end
+
+function tokenizer:dumpTrace(filePath)
+	pReturn = loveToken.LT_DumpTrace(filePath)
+	tokenizer:checkError()
+	return pReturn
 end
 
 function tokenizer:readLiteral()
@@ -1,1083 +1,6346 @@
-/*
-Copyright (c) 2015 Benjamin Moir <bennyboy.private@hotmail.com.au>
-Copyright (c) 2015 Marrub <marrub@greyserv.net>
-
-Permission is hereby granted, free of charge, to any person obtaining a copy
-of this software and associated documentation files (the "Software"), to deal
-in the Software without restriction, including without limitation the rights
-to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-copies of the Software, and to permit persons to whom the Software is
-furnished to do so, subject to the following conditions:
-
-The above copyright notice and this permission notice shall be included in
-all copies or substantial portions of the Software.
-
-THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-THE SOFTWARE.
-*/
-
-#include "lt.h"
-
-#include <stdio.h>
-#include <ctype.h>
-#include <string.h>
-#include <errno.h>
-#include <stdlib.h>
-#include <stdarg.h>
-
-#ifdef __GDCC__
-	#include <ACS_Zandronum.h>
-#else
-	#ifndef LT_NO_ICONV
-		#include <iconv.h>
-	#endif
-#endif
-
-#ifdef __GDCC__
-
-// TODO: replace these with GDCC's new file function tables or whatever they're called
-
-#define fopen LT_FOpen
-#define ftell LT_FTell
-#define fgetc LT_FGetC
-#define ungetc LT_UnGetC
-#define fseek LT_FSeek
-#define fclose LT_FClose
-#define FILE LT_File
-
-typedef struct
-{
-	__str langId;
-	__str data;
-	int pos;
-} LT_File;
-#endif
-
-/*
- * Variables
- */
-
-static LT_GarbageList *gbHead, *gbRover;
-static FILE *parseFile;
-static LT_Config cfg;
-
-#ifndef LT_NO_ICONV
-static iconv_t icDesc;
-#endif
-
-static LT_BOOL assertError = LT_FALSE;
-static char *assertString;
-static char *stringChars = (char *)"\"", *charChars = (char *)"'";
-
-static const char *errors[] = {
-	"LT_Error: Syntax error",
-	"LT_Error: Unknown operation",
-	"LT_Error: Out of memory"
-};
-
-const char *LT_TkNames[] = {
-	// [marrub] So, this was an interesting bug. This was completely misordered from the enum.
-	//          As can be guessed, this caused many issues. Seriously, all of them.
-	"TOK_Colon",   "TOK_Comma", "TOK_Div",    "TOK_Mod",    "TOK_Mul",    "TOK_Query",
-	"TOK_BraceO",  "TOK_BraceC","TOK_BrackO", "TOK_BrackC", "TOK_ParenO", "TOK_ParenC",
-	"TOK_LnEnd",   "TOK_Add2",  "TOK_Add",    "TOK_And2",   "TOK_And",    "TOK_CmpGE",
-	"TOK_ShR",     "TOK_CmpGT", "TOK_CmpLE",  "TOK_ShL",    "TOK_CmpNE",  "TOK_CmpLT",
-	"TOK_CmpEQ",   "TOK_Equal", "TOK_Not",    "TOK_OrI2",   "TOK_OrI",    "TOK_OrX2",
-	"TOK_OrX",     "TOK_Sub2",  "TOK_Sub",    "TOK_String", "TOK_Charac", "TOK_Number",
-	"TOK_Identi",  "TOK_EOF",   "TOK_ChrSeq", "TOK_Comment","TOK_Period", "TOK_Arrow",
-	"TOK_Sigil",   "TOK_Hash",  "TOK_BlkCmtO","TOK_BlkCmtC","TOK_Exp",    "TOK_NstCmtO",
-	"TOK_NstCmtC", "TOK_Semicl"
-};
-
-/*
- * Functions
- */
-
-#ifndef LT_NO_ICONV
-static void LT_DoConvert(char **str)
-{
-	size_t i = strlen(*str);
-	char *strbuf = calloc((i * 6) + 1, 1);
-	char *strbufOrig = strbuf, *strOrig = *str;
-	size_t in = i, out = i * 6;
-	
-	iconv(icDesc, str, &in, &strbuf, &out);
-	
-	*str = strOrig, strbuf = strbufOrig;
-	
-	free(*str);
-	*str = strbuf;
-}
-#endif
-
-static void *LT_Alloc(size_t size)
-{
-	void *p = malloc(size);
-	
-	if(p == NULL)
-	{ // [marrub] if we don't error it will try to allocate an assertion, thus breaking horribly
-		LT_Error(LTERR_NOMEMORY);
-	}
-	
-	return p;
-}
-
-static void *LT_ReAlloc(void *ptr, size_t newSize)
-{
-	void *p = realloc(ptr, newSize);
-	
-	if(p == NULL)
-	{
-		LT_Error(LTERR_NOMEMORY);
-	}
-	
-	return p;
-}
-
-static void *LT_SetGarbage(void *p)
-{
-#ifndef __GDCC__
-	gbRover->next = LT_Alloc(sizeof(LT_GarbageList));
-	gbRover = gbRover->next;
-	gbRover->ptr = p;
-	gbRover->next = NULL;
-	
-	return gbRover->ptr;
-#else
-	return p;
-#endif
-}
-
-#ifdef __GDCC__
-#define StrParam(...) \
-	( \
-		ACS_BeginStrParam(), \
-		__nprintf(__VA_ARGS__), \
-		ACS_EndStrParam() \
-	)
-#define StrParamL(...) (StrParam("%LS", StrParam(__VA_ARGS__)))
-
-LT_File *LT_FOpen(__str languageId, const char *mode)
-{
-	LT_File *file = LT_Alloc(sizeof(LT_File));
-	
-	file->langId = languageId;
-	file->data = StrParamL("%S", languageId);
-	file->pos = 0;
-	
-	return file;
-}
-
-int LT_FTell(LT_File *file)
-{
-	return file->pos;
-}
-
-int LT_FGetC(LT_File *file)
-{
-	int c = ACS_GetChar(file->data, file->pos++);
-	return c < 1 ? EOF : c;
-}
-
-int LT_UnGetC(int ch, LT_File *file)
-{
-	int c = ACS_GetChar(file->data, file->pos--);
-	return c < 1 ? EOF : c;
-}
-
-int LT_FSeek(LT_File *file, long int offset, int whence)
-{
-	switch(whence)
-	{
-	case SEEK_SET:
-		file->pos = offset;
-		return 0;
-	case SEEK_CUR:
-		file->pos += offset;
-		return 0;
-	case SEEK_END:
-		file->pos = ACS_StrLen(file->data) + offset;
-		return 0;
-	}
-	
-	return 1;
-}
-
-int LT_FClose(LT_File *file)
-{
-	free(file);
-	return 0;
-}
-#endif
-
-void LT_Init(LT_Config initCfg)
-{
-#ifndef __GDCC__
-	// [marrub] we don't need a garbage collector in GDCC
-	gbHead = LT_Alloc(sizeof(LT_GarbageList));
-	gbHead->next = NULL;
-	gbHead->ptr = NULL;
-	
-	gbRover = gbHead;
-#endif
-	
-	cfg = initCfg;
-	
-#ifndef LT_NO_ICONV
-	if(cfg.doConvert && cfg.fromCode != NULL && cfg.toCode != NULL)
-	{
-		icDesc = iconv_open(cfg.toCode, cfg.fromCode);
-		
-		if(icDesc == (iconv_t) -1)
-		{
-			LT_Assert(LT_TRUE, "LT_Init: Failure opening iconv");
-		}
-	}
-	else
-	{
-		cfg.doConvert = LT_FALSE;
-	}
-	
-	if(cfg.stripInvalid && cfg.doConvert)
-	{
-		cfg.stripInvalid = LT_FALSE;
-	}
-#endif
-	
-	if(cfg.stringChars != NULL)
-	{
-		unsigned i;
-		
-		stringChars = LT_Alloc(6);
-		
-		for(i = 0; i < 6; i++)
-		{
-			int c = cfg.stringChars[i];
-			
-			if(c != '\0')
-			{
-				stringChars[i] = c;
-			}
-			else
-			{
-				break;
-			}
-		}
-		
-		stringChars[i] = '\0';
-		
-		LT_SetGarbage(stringChars);
-	}
-	
-	if(cfg.charChars != NULL)
-	{
-		unsigned i;
-		
-		charChars = LT_Alloc(6);
-		
-		for(i = 0; i < 6; i++)
-		{
-			int c = cfg.charChars[i];
-			
-			if(c != '\0')
-			{
-				charChars[i] = c;
-			}
-			else
-			{
-				break;
-			}
-		}
-		
-		charChars[i] = '\0';
-		
-		LT_SetGarbage(charChars);
-	}
-}
-
-void LT_SetConfig(LT_Config newCfg)
-{
-	cfg = newCfg;
-	
-#ifndef LT_NO_ICONV
-	if(cfg.doConvert && cfg.fromCode != NULL && cfg.toCode != NULL)
-	{
-		if(icDesc != NULL)
-		{
-			iconv_close(icDesc);
-		}
-		
-		icDesc = iconv_open(cfg.toCode, cfg.fromCode);
-		
-		if(icDesc == (iconv_t) -1)
-		{
-			LT_Assert(LT_TRUE, "LT_Init: Failure opening iconv");
-		}
-	}
-	else
-	{
-		if(icDesc != NULL)
-		{
-			iconv_close(icDesc);
-			icDesc = NULL;
-		}
-		
-		cfg.doConvert = LT_FALSE;
-	}
-	
-	if(cfg.stripInvalid && cfg.doConvert)
-	{
-		cfg.stripInvalid = LT_FALSE;
-	}
-#endif
-	
-	if(cfg.stringChars != NULL)
-	{
-		unsigned i;
-		
-		stringChars = LT_Alloc(6);
-		
-		for(i = 0; i < 6; i++)
-		{
-			int c = cfg.stringChars[i];
-			
-			if(c != '\0')
-			{
-				stringChars[i] = c;
-			}
-			else
-			{
-				break;
-			}
-		}
-		
-		stringChars[i] = '\0';
-		
-		LT_SetGarbage(stringChars);
-	}
-	
-	if(cfg.charChars != NULL)
-	{
-		unsigned i;
-		
-		charChars = LT_Alloc(6);
-		
-		for(i = 0; i < 6; i++)
-		{
-			int c = cfg.charChars[i];
-			
-			if(c != '\0')
-			{
-				charChars[i] = c;
-			}
-			else
-			{
-				break;
-			}
-		}
-		
-		charChars[i] = '\0';
-		
-		LT_SetGarbage(charChars);
-	}
-}
-
-void LT_Quit()
-{
-#ifndef LT_NO_ICONV
-	if(cfg.doConvert)
-	{
-		iconv_close(icDesc);
-	}
-#endif
-	
-	LT_CloseFile();
-	
-#ifndef __GDCC__
-	gbRover = gbHead;
-	
-	while(gbRover != NULL)
-	{
-		LT_GarbageList *next = gbRover->next;
-		
-		if(gbRover->ptr != NULL)
-		{
-			free(gbRover->ptr);
-			gbRover->ptr = NULL;
-		}
-		
-		free(gbRover);
-		
-		gbRover = next;
-	}
-	
-	gbRover = NULL;
-	gbHead = NULL;
-#endif
-}
-
-LT_BOOL LT_Assert(LT_BOOL assertion, const char *fmt, ...)
-{
-	if(assertion)
-	{
-		char *asBuffer = LT_Alloc(512);
-		int place;
-		
-		if(parseFile != NULL)
-		{
-			place = (int)ftell(parseFile);
-		}
-		else
-		{
-			place = -1;
-		}
-		
-		va_list va;
-		assertError = LT_TRUE;
-		assertString = LT_Alloc(512);
-		
-		va_start(va, fmt);
-		vsprintf(asBuffer, fmt, va);
-		va_end(va);
-		
-		sprintf(assertString, "(offset %d) %s", place, asBuffer);
-		
-		LT_SetGarbage(assertString);
-		
-		free(asBuffer);
-	}
-	
-	return assertion;
-}
-
-void LT_Error(int type)
-{
-	fprintf(stderr, "%s", errors[type]);
-	exit(1);
-}
-
-LT_AssertInfo LT_CheckAssert()
-{
-	LT_AssertInfo ltAssertion;
-	ltAssertion.failure = assertError;
-	ltAssertion.str = assertString;
-	return ltAssertion;
-}
-
-#ifndef __GDCC__
-LT_BOOL LT_OpenFile(const char *filePath)
-#else
-LT_BOOL LT_OpenFile(__str filePath)
-#endif
-{
-	parseFile = fopen(filePath, "r");
-	
-	if(parseFile == NULL)
-	{
-		LT_Assert(LT_TRUE, "LT_OpenFile: %s", strerror(errno));
-		return LT_FALSE;
-	}
-	
-	return LT_TRUE;
-}
-
-void LT_SetPos(int newPos)
-{
-#ifndef __GDCC__
-	if(fseek(parseFile, newPos, SEEK_SET) != 0)
-	{
-		LT_Assert(ferror(parseFile), "LT_SetPos: %s", strerror(errno));
-	}
-#else
-	fseek(parseFile, newPos, SEEK_SET);
-#endif
-}
-
-void LT_CloseFile()
-{
-	if(parseFile != NULL)
-	{
-		fclose(parseFile);
-	}
-}
-
-char *LT_ReadNumber()
-{
-	size_t i = 0, strBlocks = 1;
-	char *str = LT_Alloc(TOKEN_STR_BLOCK_LENGTH);
-	int c = '\0';
-	
-	while(c != EOF)
-	{
-		c = fgetc(parseFile);
-		
-		if(!isalnum(c) && c != '.')
-		{
-			ungetc(c, parseFile);
-			break;
-		}
-		
-		if(i >= (TOKEN_STR_BLOCK_LENGTH * strBlocks))
-		{
-			str = LT_ReAlloc(str, 1 + TOKEN_STR_BLOCK_LENGTH * ++strBlocks);
-		}
-		
-		str[i++] = c;
-		
-		if(cfg.stripInvalid)
-		{
-			str[i++] = (isspace(c) || isprint(c)) ? c : ' ';
-		}
-	}
-	
-	str[i++] = '\0';
-	
-#ifndef LT_NO_ICONV
-	if(cfg.doConvert)
-	{
-		LT_DoConvert(&str);
-	}
-#endif
-	
-	return LT_SetGarbage(LT_ReAlloc(str, i));
-}
-
-void LT_ReadString(LT_Token *tk, char term)
-{
-	size_t i = 0, strBlocks = 1;
-	char *str = LT_Alloc(TOKEN_STR_BLOCK_LENGTH);
-	int c;
-	
-	while(LT_TRUE)
-	{
-		c = fgetc(parseFile);
-		
-		if(c == term)
-		{
-			break;
-		}
-		
-		if(LT_Assert(c == EOF || c == '\n', "LT_ReadString: Unterminated string literal"))
-		{
-			char *emptyString = LT_Alloc(2);
-			emptyString[0] = '\0';
-			emptyString[1] = '\0';
-			
-			tk->string = LT_SetGarbage(emptyString);
-			tk->strlen = 0;
-			
-			return;
-		}
-		
-		if(c == '\\' && cfg.escapeChars)
-		{
-			c = fgetc(parseFile);
-			
-			if(LT_Assert(c == EOF || c == '\n', "LT_ReadString: Unterminated string literal"))
-			{
-				str[i++] = '\0';
-				tk->strlen = (unsigned)i - 1;
-				tk->string = LT_SetGarbage(LT_ReAlloc(str, i));
-				return;
-			}
-			
-			if(i >= (TOKEN_STR_BLOCK_LENGTH * strBlocks))
-			{
-				str = LT_ReAlloc(str, 1 + TOKEN_STR_BLOCK_LENGTH * ++strBlocks);
-			}
-			
-			str = LT_Escaper(str, i++, c);
-		}
-		else
-		{
-			if(i >= (TOKEN_STR_BLOCK_LENGTH * strBlocks))
-			{
-				str = LT_ReAlloc(str, 1 + TOKEN_STR_BLOCK_LENGTH * ++strBlocks);
-			}
-			
-			str[i++] = c;
-			
-			if(cfg.stripInvalid)
-			{
-				str[i++] = (isspace(c) || isprint(c)) ? c : ' ';
-			}
-		}
-	}
-	
-	str[i++] = '\0';
-	
-#ifndef LT_NO_ICONV
-	if(cfg.doConvert)
-	{
-		LT_DoConvert(&str);
-	}
-#endif
-	
-	tk->strlen = (unsigned)i - 1;
-	tk->string = LT_SetGarbage(LT_ReAlloc(str, i));
-	
-	return;
-}
-
-char *LT_Escaper(char *str, size_t pos, char escape)
-{
-	unsigned i;
-	LT_BOOL exitloop = LT_FALSE;
-	
-	switch(escape)
-	{
-		case '\\': case '\'': case '"':  str[pos] = escape; break;
-		case 'a': str[pos] = '\a'; break;
-		case 'b': str[pos] = '\b'; break;
-		case 'f': str[pos] = '\f'; break;
-		case 'n': str[pos] = '\n'; break;
-		case 'r': str[pos] = '\r'; break;
-		case 't': str[pos] = '\t'; break;
-		case 'v': str[pos] = '\v'; break;
-		case 'x': // [marrub] THIS ONE IS FUN
-			i = 0;
-			while(!exitloop)
-			{
-				int c = fgetc(parseFile);
-				
-				switch(c)
-				{
-					case '0': i = i * 16 + 0x0; break;
-					case '1': i = i * 16 + 0x1; break;
-					case '2': i = i * 16 + 0x2; break;
-					case '3': i = i * 16 + 0x3; break;
-					case '4': i = i * 16 + 0x4; break;
-					case '5': i = i * 16 + 0x5; break;
-					case '6': i = i * 16 + 0x6; break;
-					case '7': i = i * 16 + 0x7; break;
-					case '8': i = i * 16 + 0x8; break;
-					case '9': i = i * 16 + 0x9; break;
-					case 'a': case 'A': i = i * 16 + 0xA; break;
-					case 'b': case 'B': i = i * 16 + 0xB; break;
-					case 'c': case 'C': i = i * 16 + 0xC; break;
-					case 'd': case 'D': i = i * 16 + 0xD; break;
-					case 'e': case 'E': i = i * 16 + 0xE; break;
-					case 'f': case 'F': i = i * 16 + 0xF; break;
-					
-					default:
-						ungetc(c, parseFile);
-						str[pos] = i;
-						exitloop = LT_TRUE;
-						break;
-				}
-			}
-			
-			break;
-		
-		case '0': case '1': case '2': case '3':
-		case '4': case '5': case '6': case '7':
-			{
-				int c = escape;
-				unsigned n;
-				
-				i = 0;
-				
-				for(n = 2; n != 0; n--)
-				{
-					switch(c)
-					{
-						case '0': i = i * 8 + 00; break;
-						case '1': i = i * 8 + 01; break;
-						case '2': i = i * 8 + 02; break;
-						case '3': i = i * 8 + 03; break;
-						case '4': i = i * 8 + 04; break;
-						case '5': i = i * 8 + 05; break;
-						case '6': i = i * 8 + 06; break;
-						case '7': i = i * 8 + 07; break;
-						default:
-							ungetc(c, parseFile);
-							str[pos] = i;
-							return str;
-					}
-					
-					c = fgetc(parseFile);
-				}
-				
-				str[pos] = i;
-				break;
-			}
-			
-			break;
-		default:
-			LT_Assert(LT_TRUE, "LT_Escaper: Unknown escape character '%c'", escape);
-			break;
-	}
-	
-	return str;
-}
-
-LT_Token LT_GetToken()
-{
-	LT_Token tk = { 0 };
-	int c = fgetc(parseFile);
-	
-	if(c == EOF)
-	{
-		tk.token = LT_TkNames[TOK_EOF];
-		tk.pos = ftell(parseFile);
-		return tk;
-	}
-	
-	while(isspace(c) && c != '\n')
-	{
-		c = fgetc(parseFile);
-		
-		if(c == EOF) // [marrub] This could have caused issues if there was whitespace before EOF.
-		{
-			tk.token = LT_TkNames[TOK_EOF];
-			tk.pos = ftell(parseFile);
-			return tk;
-		}
-	}
-	
-	tk.pos = ftell(parseFile) - 1;
-	
-	switch(c)
-	{
-	case '$':  tk.token = LT_TkNames[TOK_Sigil];  return tk;
-	case '#':  tk.token = LT_TkNames[TOK_Hash];   return tk;
-	case '.':  tk.token = LT_TkNames[TOK_Period]; return tk;
-	case ':':  tk.token = LT_TkNames[TOK_Colon];  return tk;
-	case ';':  tk.token = LT_TkNames[TOK_Semicl]; return tk;
-	case ',':  tk.token = LT_TkNames[TOK_Comma];  return tk;
-	case '%':  tk.token = LT_TkNames[TOK_Mod];    return tk;
-	case '?':  tk.token = LT_TkNames[TOK_Query];  return tk;
-	case '{':  tk.token = LT_TkNames[TOK_BraceO]; return tk;
-	case '}':  tk.token = LT_TkNames[TOK_BraceC]; return tk;
-	case '[':  tk.token = LT_TkNames[TOK_BrackO]; return tk;
-	case ']':  tk.token = LT_TkNames[TOK_BrackC]; return tk;
-	case '(':  tk.token = LT_TkNames[TOK_ParenO]; return tk;
-	case ')':  tk.token = LT_TkNames[TOK_ParenC]; return tk;
-	case '\n': tk.token = LT_TkNames[TOK_LnEnd];  return tk;
-	
-	// [marrub] Sorry, I wouldn't normally do a quick and dirty hack like this,
-	//          but sometimes I really do care about my sanity. And wrists.
-#define DoubleTokDef(ch, t1, t2) \
-	case ch: \
-		c = fgetc(parseFile); \
-		\
-		if(c == ch) \
-		{ \
-			tk.token = LT_TkNames[t2]; \
-		} \
-		else \
-		{ \
-			tk.token = LT_TkNames[t1]; \
-			ungetc(c, parseFile); \
-		} \
-		\
-		return tk;
-	
-	DoubleTokDef('&', TOK_And, TOK_And2);
-	DoubleTokDef('=', TOK_Equal, TOK_CmpEQ);
-	DoubleTokDef('^', TOK_OrX, TOK_OrX2);
-	DoubleTokDef('|', TOK_OrI, TOK_OrI2);
-	
-#undef DoubleTokDef
-	
-	// [marrub] Special god damn snowflakes
-	case '>':
-		c = fgetc(parseFile);
-		
-		if(c == '=')
-		{
-			tk.token = LT_TkNames[TOK_CmpGE];
-		}
-		else if(c == '>')
-		{
-			tk.token = LT_TkNames[TOK_ShR];
-		}
-		else
-		{
-			tk.token = LT_TkNames[TOK_CmpGT];
-			ungetc(c, parseFile);
-		}
-		
-		return tk;
-	case '<':
-		c = fgetc(parseFile);
-		
-		if(c == '=')
-		{
-			tk.token = LT_TkNames[TOK_CmpLE];
-		}
-		else if(c == '<')
-		{
-			tk.token = LT_TkNames[TOK_ShL];
-		}
-		else if(c == '>')
-		{
-			tk.token = LT_TkNames[TOK_CmpNE];
-		}
-		else
-		{
-			tk.token = LT_TkNames[TOK_CmpLT];
-			ungetc(c, parseFile);
-		}
-		
-		return tk;
-	case '!':
-		c = fgetc(parseFile);
-		
-		if(c == '=')
-		{
-			tk.token = LT_TkNames[TOK_CmpNE];
-		}
-		else
-		{
-			tk.token = LT_TkNames[TOK_Not];
-			ungetc(c, parseFile);
-		}
-		
-		return tk;
-	case '~':
-		c = fgetc(parseFile);
-		
-		if(c == '=')
-		{
-			tk.token = LT_TkNames[TOK_CmpNE];
-		}
-		else
-		{
-			ungetc(c, parseFile);
-			tk.token = LT_TkNames[TOK_ChrSeq];
-			tk.string = LT_Alloc(2);
-			tk.string[0] = c;
-			tk.string[1] = '\0';
-			
-			LT_SetGarbage(tk.string);
-		}
-		
-		return tk;
-	// [zombie] extra tokens
-	case '/':
-		c = fgetc(parseFile);
-		
-		if(c == '/')
-		{
-			tk.token = LT_TkNames[TOK_Comment];
-		}
-		else if(c == '*')
-		{
-			tk.token = LT_TkNames[TOK_BlkCmtO];
-		}
-		else if(c == '+')
-		{
-			tk.token = LT_TkNames[TOK_NstCmtO];
-		}
-		else
-		{
-			tk.token = LT_TkNames[TOK_Div];
-			ungetc(c, parseFile);
-		}
-		
-		return tk;
-	case '*':
-		c = fgetc(parseFile);
-		
-		if(c == '/')
-		{
-			tk.token = LT_TkNames[TOK_BlkCmtC];
-		}
-		else if(c == '*')
-		{
-			tk.token = LT_TkNames[TOK_Exp];
-		}
-		else
-		{
-			tk.token = LT_TkNames[TOK_Mul];
-			ungetc(c, parseFile);
-		}
-		
-		return tk;
-	case '-':
-		c = fgetc(parseFile);
-		
-		if(c == '-')
-		{
-			tk.token = LT_TkNames[TOK_Sub2];
-		}
-		else if (c == '>')
-		{
-			tk.token = LT_TkNames[TOK_Arrow];
-		}
-		else
-		{
-			tk.token = LT_TkNames[TOK_Sub];
-			ungetc(c, parseFile);
-		}
-		
-		return tk;
-	case '+':
-		c = fgetc(parseFile);
-		
-		if (c == '/')
-		{
-			tk.token = LT_TkNames[TOK_NstCmtC];
-		}
-		else if (c == '+')
-		{
-			tk.token = LT_TkNames[TOK_Add2];
-		}
-		else
-		{
-			tk.token = LT_TkNames[TOK_Add];
-			ungetc(c, parseFile);
-		}
-		
-		return tk;
-	}
-	
-	
-	if(stringChars[0] != '\0')
-	{
-		unsigned i;
-		
-		for(i = 0; i < 6;)
-		{
-			char cc = stringChars[i++];
-			
-			if(cc == '\0')
-			{
-				break;
-			}
-			else if(c == cc)
-			{
-				tk.token = LT_TkNames[TOK_String];
-				LT_ReadString(&tk, c);
-				return tk;
-			}
-		}
-	}
-	
-	if(charChars[0] != '\0')
-	{
-		unsigned i;
-		
-		for(i = 0; i < 6;)
-		{
-			char cc = charChars[i++];
-			
-			if(cc == '\0')
-			{
-				break;
-			}
-			else if(c == cc)
-			{
-				tk.token = LT_TkNames[TOK_Charac];
-				LT_ReadString(&tk, c);
-				return tk;
-			}
-		}
-	}
-	
-	if(isdigit(c))
-	{
-		ungetc(c, parseFile);
-		
-		tk.token = LT_TkNames[TOK_Number];
-		tk.string = LT_ReadNumber();
-		return tk;
-	}
-	
-	if(isalpha(c) || c == '_')
-	{
-		size_t i = 0, strBlocks = 1;
-		char *str = LT_Alloc(TOKEN_STR_BLOCK_LENGTH);
-		
-		while(c != EOF && (isalnum(c) || c == '_'))
-		{
-			if(i >= (TOKEN_STR_BLOCK_LENGTH * strBlocks))
-			{
-				str = LT_ReAlloc(str, 1 + TOKEN_STR_BLOCK_LENGTH * ++strBlocks);
-			}
-			
-			str[i++] = c;
-			
-			c = fgetc(parseFile);
-		}
-		
-		str[i++] = '\0'; // [marrub] Completely forgot this line earlier. Really screwed up everything.
-		
-#ifndef LT_NO_ICONV
-		if(cfg.doConvert)
-		{
-			LT_DoConvert(&str);
-		}
-#endif
-		
-		ungetc(c, parseFile);
-		
-		tk.token = LT_TkNames[TOK_Identi];
-		tk.string = LT_SetGarbage(LT_ReAlloc(str, i));
-		return tk;
-	}
-	
-	tk.token = LT_TkNames[TOK_ChrSeq];
-	tk.string = LT_Alloc(2);
-	tk.string[0] = c;
-	tk.string[1] = '\0';
-	
-	tk.string = LT_SetGarbage(tk.string);
-	
-	return tk;
-}
-
-char *LT_ReadLiteral()
-{
-	size_t i = 0;
-	size_t strBlocks = 1;
-	int c;
-	char *str = LT_Alloc(TOKEN_STR_BLOCK_LENGTH);
-	
-	while(LT_TRUE)
-	{
-		c = fgetc(parseFile);
-		if(c == '\r' || c == '\n' || c == EOF) break;
-		
-		if(i >= (TOKEN_STR_BLOCK_LENGTH * strBlocks))
-		{
-			str = LT_ReAlloc(str, 1 + TOKEN_STR_BLOCK_LENGTH * ++strBlocks);
-		}
-		
-		str[i++] = c;
-	}
-	
-	str[i++] = '\0';
-	
-	return LT_SetGarbage(LT_ReAlloc(str, i));
-}
-
-void LT_SkipWhite()
-{
-	char c = fgetc(parseFile);
-	
-	while(isspace(c) && c != EOF)
-	{
-		c = fgetc(parseFile);
-	}
-	
-	ungetc(c, parseFile);
-}
-
-void LT_SkipWhite2()
-{
-	char c = fgetc(parseFile);
-	
-	while(isspace(c) && c != EOF && c != '\r' && c != '\n')
-	{
-		c = fgetc(parseFile);
-	}
-	
-	ungetc(c, parseFile);
-}
+/*
+Copyright (c) 2015 Benjamin Moir <bennyboy.private@hotmail.com.au>
+Copyright (c) 2015 Marrub <marrub@greyserv.net>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#if !defined(_WIN32) && !defined(__GDCC__) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L // for mmap and friends under --std=c99
+#endif
+
+#include "lt.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <float.h>
+#include <locale.h>
+#include <setjmp.h>
+
+#ifdef __GDCC__
+	#include <ACS_Zandronum.h>
+#else
+	#ifndef LT_NO_ICONV
+		#include <iconv.h>
+	#endif
+#endif
+
+#ifndef LT_NO_MMAP
+	#ifdef _WIN32
+		#include <windows.h>
+	#else
+		#include <sys/types.h>
+		#include <sys/stat.h>
+		#include <sys/mman.h>
+		#include <fcntl.h>
+		#include <unistd.h>
+	#endif
+#endif
+
+#ifndef LT_NO_THREADS
+	#ifdef _WIN32
+		#include <windows.h>
+	#else
+		#include <pthread.h>
+		#include <unistd.h>
+	#endif
+#endif
+
+#ifndef LT_NO_TRACE
+	#ifdef _WIN32
+		#include <windows.h>
+	#else
+		#include <time.h>
+	#endif
+#endif
+
+#ifndef LT_NO_SIMD
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define LT_HAVE_SSE2
+		#include <emmintrin.h>
+		
+		#ifdef _MSC_VER
+			#include <intrin.h>
+		#endif
+	#endif
+	
+	// AVX2 is picked at runtime, which needs GCC or Clang's target attribute.
+	#if defined(LT_HAVE_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		#define LT_HAVE_AVX2
+		#include <immintrin.h>
+	#endif
+#endif
+
+#ifdef __GDCC__
+
+// TODO: replace these with GDCC's new file function tables or whatever they're called
+
+#define fopen LT_FOpen
+#define ftell LT_FTell
+#define fgetc LT_FGetC
+#define ungetc LT_UnGetC
+#define fseek LT_FSeek
+#define fclose LT_FClose
+#define FILE LT_File
+
+typedef struct
+{
+	__str langId;
+	__str data;
+	int pos;
+} LT_File;
+#endif
+
+#define LT_ARENA_ALIGN 8
+
+// Bumps one of a context's LT_Stats counters.
+#ifndef LT_NO_STATS
+	#define LT_COUNT(ctx, field, n) ((ctx)->stats.field += (n))
+#else
+	#define LT_COUNT(ctx, field, n) ((void)0)
+#endif
+
+// LT_GetToken calls are traced in batches of this many tokens, and string
+// literals at least this long get an event of their own.
+#define LT_TRACE_BATCH 256
+#define LT_TRACE_LONG_STRING 1024
+#define LT_TRACE_DETAIL 64
+
+// Longest error message LT_CheckAssert or LT_Assert will make.
+#define LT_ERROR_TEXT 512
+
+// Bumped whenever token caches would be read differently.
+#define LT_CACHE_VERSION 1
+
+// Most bytes of an unfinished character LT_Feed will hold on to when
+// converting or stripping a stream.
+#define LT_FEED_PENDING 8
+
+// LT_TokenizeParallel won't split a buffer into chunks smaller than this.
+#ifndef LT_PARALLEL_MIN_CHUNK
+#define LT_PARALLEL_MIN_CHUNK 65536
+#endif
+
+// How far ahead of a token the line index of a buffer is built at a time.
+#define LT_LINE_BLOCK 4096
+
+// Character classes, one per byte, used to pick what to lex.
+enum
+{
+	LT_CC_OTHER,
+	LT_CC_SPACE, // whitespace other than '\n'
+	LT_CC_OPER,  // see ltOpTrans
+	LT_CC_STRING,
+	LT_CC_CHAR,
+	LT_CC_DIGIT,
+	LT_CC_IDENT
+};
+
+// Character flags, for scanning runs of characters.
+enum
+{
+	LT_CF_SPACE  = 1 << 0, // isspace
+	LT_CF_IDENT  = 1 << 1, // isalnum or '_'
+	LT_CF_NUMBER = 1 << 2, // isalnum or '.'
+	LT_CF_PRINT  = 1 << 3  // isspace or isprint
+};
+
+// Character sets the scanning kernels can skip over.
+enum
+{
+	LT_SCAN_SPACE,  // LT_CF_SPACE
+	LT_SCAN_BLANK,  // LT_CF_SPACE other than '\n'
+	LT_SCAN_BLANK2, // LT_CF_SPACE other than '\r' and '\n'
+	LT_SCAN_IDENT,  // LT_CF_IDENT
+	LT_SCAN_NUMBER, // LT_CF_NUMBER
+	LT_SCAN_TEXT,   // printable ASCII or LT_CF_SPACE
+	LT_SCAN_MAX
+};
+
+/*
+ * Types
+ */
+
+// What an operator character lexes to: kind on its own, or nextKind[i] if
+// it's followed by next[i].
+typedef struct
+{
+	unsigned char kind;
+	char next[3];
+	unsigned char nextKind[3];
+} LT_OpTrans;
+
+// Returns the first character in [p, end) that isn't in the kernel's set.
+typedef const char *(*LT_ScanFunc)(const char *p, const char *end);
+
+typedef struct LT_ArenaChunk_s
+{
+	struct LT_ArenaChunk_s *next;
+	size_t size, used;
+	char data[];
+} LT_ArenaChunk;
+
+typedef struct
+{
+	const char *str;
+	unsigned len, hash;
+} LT_Symbol;
+
+// A point in the arena that LT_RewindArena can free everything back to.
+typedef struct
+{
+	LT_ArenaChunk *chunk, *next;
+	size_t used;
+} LT_ArenaMark;
+
+// A piece of the buffer for LT_TokenizeParallel. Its tokens are lexed as
+// if a token started at start, which is checked when they're stitched.
+typedef struct
+{
+	size_t start, end; // tokens starting in [start, end) belong here
+	size_t stop;       // bufPos after the last token
+	LT_BOOL ranOut;    // its worker ran out of memory before its end
+	LT_Token *tokens;
+	size_t count, cap;
+	size_t *errorAt;   // which token raised each error
+	size_t errorCount, errorCap;
+	LT_ErrorInfo errors[LT_ERROR_RING]; // the last LT_ERROR_RING of them
+} LT_ParChunk;
+
+typedef struct
+{
+	LT_Context *ctx;
+	LT_ParChunk *chunks;
+	size_t first, numChunks, stride;
+} LT_ParWorker;
+
+struct LT_Document_s
+{
+	LT_Context *ctx;
+	char *text;
+	char *stripped; // with stripInvalid, what's lexed: text as LT_StripSource leaves it
+	size_t len, cap;
+	LT_Token *tokens; // always ends with TOK_EOF
+	size_t count, tokCap;
+	size_t dropped;   // tokens thrown away since the arena was last cleared
+};
+
+// A run of tokens in the output of LT_TokenizeParallel.
+typedef struct
+{
+	const LT_Token *tokens;
+	size_t count;
+} LT_ParRun;
+
+// A token cache starts with this, followed by symBytes of the symbols'
+// names, strBytes of other strings (all NUL-terminated), and tokBytes of
+// tokens. The header is in the writer's byte order and layout, which
+// version and headerSize are there to check.
+typedef struct
+{
+	char magic[4]; // "LTTC"
+	unsigned version, headerSize;
+	unsigned long long srcHash, cfgHash, bodyHash, srcLen, count, symCount;
+	unsigned long long symBytes, strBytes, tokBytes;
+} LT_CacheHeader;
+
+// Each cached token is a number of LT_CACHE_* flags, its kind, how far its
+// pos and line are from the last token's and its col, then whichever of
+// these its flags say it has, so none takes less than five bytes. Numbers
+// are written as LT_CachePutNum does.
+enum
+{
+	LT_CACHE_SPAN    = 1 << 0, // spanPos from pos, spanLen
+	LT_CACHE_STRLEN  = 1 << 1, // strlen, when it isn't spanLen
+	LT_CACHE_STRING  = 1 << 2, // offset into the strings
+	LT_CACHE_SYMBOL  = 1 << 3, // which symbol, from 1
+	LT_CACHE_NUMBER  = 1 << 4, // numType, suffixLen, intValue, then floatValue's bytes
+	LT_CACHE_ESCAPES = 1 << 5  // hasEscapes (nothing more is written)
+};
+
+// A growing buffer a cache is put together in.
+typedef struct
+{
+	char *data;
+	size_t len, cap;
+} LT_CacheBuf;
+
+#ifndef LT_NO_TRACE
+// Times are in nanoseconds from when the trace started.
+typedef struct
+{
+	const char *name;
+	unsigned long long start, dur, busy; // busy is time spent lexing a batch
+	size_t count; // tokens in a batch or bytes read or converted
+	char detail[LT_TRACE_DETAIL]; // a file name or assertion
+	char phase; // 'X' for spans, 'i' for instants
+} LT_TraceRecord;
+
+// A ring of events; next is where the next one goes.
+typedef struct
+{
+	LT_TraceRecord *events;
+	size_t cap, next, count;
+	unsigned long long origin;
+	LT_BOOL recording;
+	
+	// The LT_GetToken batch being timed.
+	unsigned long long batchStart, batchEnd, batchBusy;
+	size_t batchTokens;
+} LT_Trace;
+#endif
+
+struct LT_Context_s
+{
+	LT_BOOL ready;
+	LT_Config cfg;
+	FILE *parseFile;
+	LT_ArenaChunk *arena;
+	
+	// Bytes held for tokens and sources, which cfg.memLimit caps, and how
+	// many of them are bufOwned's. While tokens are lexed with a limit,
+	// recover is where running out of memory jumps back to, and failMark
+	// and failStart are where the token being lexed started.
+	size_t memUsed, ownedSize;
+	jmp_buf *recover;
+	LT_ArenaMark failMark;
+	long failStart;
+	
+	// When buf isn't NULL, we're reading from memory instead of parseFile.
+	const char *buf;
+	size_t bufLen, bufPos;
+	char *bufOwned;
+	void *mapBase;
+	size_t mapLen;
+	
+	// Set by LT_Feed. buf holds what hasn't been lexed yet, which starts at
+	// streamBase in the whole stream.
+	LT_BOOL streaming, streamEnd, starved, hitEnd;
+	size_t streamBase, feedCap;
+	
+	// Fed bytes that can't be used until more come, like the start of a
+	// character split between two LT_Feed calls.
+	char pending[LT_FEED_PENDING];
+	size_t pendingLen;
+	
+	// Where each line starts in the source (or the whole stream), as far as
+	// lineScanned. lineHint is the line of the last offset looked up.
+	size_t *lineStarts;
+	size_t lineCount, lineCap, lineHint, lineScanned;
+	
+#ifndef LT_NO_ICONV
+	// With doConvert, sources are converted to toCode as they're opened or
+	// fed. icDesc converts from icFrom (NULL until there's been an input),
+	// and isn't open if that's toCode already. The start of a stream is
+	// pending until its BOM (if any) is known. fromCode and toCode are the
+	// config's copies of its encodings.
+	LT_BOOL icOpen, icDetect;
+	iconv_t icDesc;
+	const char *icFrom;
+	char *fromCode, *toCode;
+#endif
+	
+	// Errors raised, the last LT_ERROR_RING of which are kept. assertCount
+	// only goes up, and the newest error is errorRing[(assertCount - 1) %
+	// LT_ERROR_RING]. Ones raised before errorBase have been cleared, and
+	// ones raised before errorsPlaced have their line and column.
+	// errorText is made from the newest one when LT_CheckAssert asks, and
+	// assertText is the message of the latest LT_Assert.
+	LT_BOOL assertError;
+	unsigned assertCount, errorBase, errorsPlaced;
+	LT_ErrorInfo errorRing[LT_ERROR_RING];
+	char errorText[LT_ERROR_TEXT], assertText[LT_ERROR_TEXT];
+	unsigned char charClass[256], charFlags[256];
+	const LT_ScanFunc *scan;
+	
+#ifndef LT_NO_STATS
+	LT_Stats stats;
+#endif
+	
+#ifndef LT_NO_TRACE
+	LT_Trace *trace; // NULL until LT_StartTrace
+#endif
+	
+	// Interned identifiers. symSlots is an open addressing hash table of
+	// symbol IDs (0 is empty), and symbols[id - 1] is the symbol. These are
+	// kept until the context is destroyed, not freed by LT_ReleaseStrings.
+	unsigned *symSlots;
+	size_t symSlotCount;
+	LT_Symbol *symbols;
+	size_t symCount, symCap;
+	LT_ArenaChunk *symArena;
+	
+	// Keywords from the config, found with a perfect hash: the low bits of a
+	// keyword's hash pick a bucket, and the bucket's displacement in keyDisp
+	// sends it to a slot of its own in keySlots, which holds its index + 1
+	// (0 is empty). keyList is the config's copy of the keywords.
+	LT_Symbol *keywords;
+	size_t keyCount;
+	const char **keyList;
+	unsigned *keyDisp, *keySlots;
+	unsigned keyBucketMask, keySlotMask, keySeed;
+	LT_ArenaChunk *keyArena;
+};
+
+/*
+ * Variables
+ */
+
+static LT_Context defaultCtx;
+
+static const char *errors[] = {
+	"LT_Error: Syntax error",
+	"LT_Error: Unknown operation",
+	"LT_Error: Out of memory"
+};
+
+// What each error says after the name of what raised it. The ones with an
+// arg are written out in LT_FormatError.
+static const char *const ltErrorText[LT_ERR_MAX] = {
+	[LT_ERR_NONE]         = "No error",
+	[LT_ERR_ICONV]        = "Failure opening iconv",
+	[LT_ERR_NULL_DATA]    = "NULL data",
+	[LT_ERR_STREAM_SEEK]  = "Can't seek in a stream",
+	[LT_ERR_UNTERMINATED] = "Unterminated string literal",
+	[LT_ERR_KEYWORDS]     = "Couldn't build the keyword table",
+	[LT_ERR_NOT_BUFFER]   = "source must be a buffer (use LT_OpenMemory or mapFiles)",
+	[LT_ERR_NO_TRACE]     = "No trace was started",
+	[LT_ERR_EDIT_RANGE]   = "Edit out of range",
+	[LT_ERR_NULL_INSERT]  = "NULL inserted text",
+	[LT_ERR_COMMENT]      = "Unterminated comment"
+};
+
+const char *LT_TkNames[] = {
+	// [marrub] So, this was an interesting bug. This was completely misordered from the enum.
+	//          As can be guessed, this caused many issues. Seriously, all of them.
+	"TOK_Colon",   "TOK_Comma", "TOK_Div",    "TOK_Mod",    "TOK_Mul",    "TOK_Query",
+	"TOK_BraceO",  "TOK_BraceC","TOK_BrackO", "TOK_BrackC", "TOK_ParenO", "TOK_ParenC",
+	"TOK_LnEnd",   "TOK_Add2",  "TOK_Add",    "TOK_And2",   "TOK_And",    "TOK_CmpGE",
+	"TOK_ShR",     "TOK_CmpGT", "TOK_CmpLE",  "TOK_ShL",    "TOK_CmpNE",  "TOK_CmpLT",
+	"TOK_CmpEQ",   "TOK_Equal", "TOK_Not",    "TOK_OrI2",   "TOK_OrI",    "TOK_OrX2",
+	"TOK_OrX",     "TOK_Sub2",  "TOK_Sub",    "TOK_String", "TOK_Charac", "TOK_Number",
+	"TOK_Identi",  "TOK_EOF",   "TOK_ChrSeq", "TOK_Comment","TOK_Period", "TOK_Arrow",
+	"TOK_Sigil",   "TOK_Hash",  "TOK_BlkCmtO","TOK_BlkCmtC","TOK_Exp",    "TOK_NstCmtO",
+	"TOK_NstCmtC", "TOK_Semicl", "TOK_Keywrd"
+};
+
+static const char ltOpChars[] = "$#.:;,%?{}[]()\n&=^|><!~/*-+";
+
+static const LT_OpTrans ltOpTrans[256] = {
+	['$']  = { TOK_Sigil },
+	['#']  = { TOK_Hash },
+	['.']  = { TOK_Period },
+	[':']  = { TOK_Colon },
+	[';']  = { TOK_Semicl },
+	[',']  = { TOK_Comma },
+	['%']  = { TOK_Mod },
+	['?']  = { TOK_Query },
+	['{']  = { TOK_BraceO },
+	['}']  = { TOK_BraceC },
+	['[']  = { TOK_BrackO },
+	[']']  = { TOK_BrackC },
+	['(']  = { TOK_ParenO },
+	[')']  = { TOK_ParenC },
+	['\n'] = { TOK_LnEnd },
+	['&']  = { TOK_And,    "&",   { TOK_And2 } },
+	['=']  = { TOK_Equal,  "=",   { TOK_CmpEQ } },
+	['^']  = { TOK_OrX,    "^",   { TOK_OrX2 } },
+	['|']  = { TOK_OrI,    "|",   { TOK_OrI2 } },
+	['>']  = { TOK_CmpGT,  "=>",  { TOK_CmpGE,   TOK_ShR } },
+	['<']  = { TOK_CmpLT,  "=<>", { TOK_CmpLE,   TOK_ShL,     TOK_CmpNE } },
+	['!']  = { TOK_Not,    "=",   { TOK_CmpNE } },
+	['~']  = { TOK_ChrSeq, "=",   { TOK_CmpNE } },
+	// [zombie] extra tokens
+	['/']  = { TOK_Div,    "/*+", { TOK_Comment, TOK_BlkCmtO, TOK_NstCmtO } },
+	['*']  = { TOK_Mul,    "/*",  { TOK_BlkCmtC, TOK_Exp } },
+	['-']  = { TOK_Sub,    "->",  { TOK_Sub2,    TOK_Arrow } },
+	['+']  = { TOK_Add,    "/+",  { TOK_NstCmtC, TOK_Add2 } }
+};
+
+enum
+{
+	LT_ESC_HEX = 0x100,
+	LT_ESC_OCT
+};
+
+// What the character after a backslash stands for. Zero means it isn't an
+// escape, and LT_ESC_HEX and LT_ESC_OCT mean digits make up the value.
+static const short ltEscapes[256] = {
+	['\\'] = '\\', ['\''] = '\'', ['"'] = '"',
+	['a']  = '\a',  ['b']  = '\b',  ['f'] = '\f', ['n'] = '\n',
+	['r']  = '\r',  ['t']  = '\t',  ['v'] = '\v',
+	['x']  = LT_ESC_HEX,
+	['0']  = LT_ESC_OCT, ['1'] = LT_ESC_OCT, ['2'] = LT_ESC_OCT, ['3'] = LT_ESC_OCT,
+	['4']  = LT_ESC_OCT, ['5'] = LT_ESC_OCT, ['6'] = LT_ESC_OCT, ['7'] = LT_ESC_OCT
+};
+
+// Hex digits' values plus one, so zero means it isn't one.
+static const unsigned char ltHexDigits[256] = {
+	['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,
+	['5'] = 6,  ['6'] = 7,  ['7'] = 8,  ['8'] = 9,  ['9'] = 10,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16
+};
+
+/*
+ * Functions
+ */
+
+static LT_BOOL LT_Raise(LT_Context *ctx, LT_BOOL assertion, const char *func, int code, long arg, const char *detail);
+static LT_BOOL LT_RaiseAt(LT_Context *ctx, LT_BOOL assertion, long pos, const char *func, int code, long arg, const char *detail);
+
+// Fails the token being lexed, or exits if there isn't one to fail.
+static void LT_OutOfMemory(LT_Context *ctx, size_t size)
+{
+	if(ctx != NULL && ctx->recover != NULL)
+	{
+		jmp_buf *recover = ctx->recover;
+		
+		// The recovery point is used up once it's jumped to.
+		ctx->recover = NULL;
+		LT_Raise(ctx, LT_TRUE, "LT_GetToken", LT_ERR_MEMORY, (long)size, NULL);
+		longjmp(*recover, 1);
+	}
+	
+	LT_Error(LTERR_NOMEMORY);
+}
+
+static void *LT_Alloc(LT_Context *ctx, size_t size)
+{
+	void *p = malloc(size);
+	
+	if(p == NULL)
+	{ // [marrub] if we don't error it will try to allocate an assertion, thus breaking horribly
+		LT_OutOfMemory(ctx, size);
+	}
+	
+	if(ctx != NULL)
+	{
+		LT_COUNT(ctx, allocs, 1);
+		LT_COUNT(ctx, allocBytes, size);
+	}
+	
+	return p;
+}
+
+static void *LT_ReAlloc(LT_Context *ctx, void *ptr, size_t newSize)
+{
+	void *p = realloc(ptr, newSize);
+	
+	if(p == NULL)
+	{
+		LT_OutOfMemory(ctx, newSize);
+	}
+	
+	if(ctx != NULL)
+	{
+		LT_COUNT(ctx, allocs, 1);
+		LT_COUNT(ctx, allocBytes, newSize);
+	}
+	
+	return p;
+}
+
+// Whether size more bytes fit under the context's memLimit.
+static inline LT_BOOL LT_Budget(LT_Context *ctx, size_t size)
+{
+	return ctx->cfg.memLimit == 0 || (ctx->memUsed <= ctx->cfg.memLimit && size <= ctx->cfg.memLimit - ctx->memUsed);
+}
+
+// Like LT_ReAlloc, but returns NULL instead of failing when newSize bytes
+// can't be had or don't fit under memLimit, leaving ptr as it was.
+static void *LT_TryReAlloc(LT_Context *ctx, void *ptr, size_t newSize)
+{
+	void *p;
+	
+	if(!LT_Budget(ctx, newSize) || (p = realloc(ptr, newSize)) == NULL)
+	{
+		return NULL;
+	}
+	
+	LT_COUNT(ctx, allocs, 1);
+	LT_COUNT(ctx, allocBytes, newSize);
+	
+	return p;
+}
+
+// Makes sure size more bytes can be held before they're allocated, failing
+// the token being lexed if they can't. Anything that isn't lexing checks
+// LT_Budget itself. memUsed goes up once they've been allocated.
+static inline void LT_Reserve(LT_Context *ctx, size_t size)
+{
+	if(ctx->recover != NULL && !LT_Budget(ctx, size))
+	{
+		LT_OutOfMemory(ctx, size);
+	}
+}
+
+static inline void LT_Unreserve(LT_Context *ctx, size_t size)
+{
+	ctx->memUsed -= size < ctx->memUsed ? size : ctx->memUsed;
+}
+
+// Hands the context a source buffer to free when it's closed.
+static void LT_OwnBuffer(LT_Context *ctx, char *buf, size_t size)
+{
+	ctx->bufOwned = buf;
+	ctx->ownedSize = buf != NULL ? size : 0;
+	ctx->memUsed += ctx->ownedSize;
+}
+
+static LT_ArenaChunk *LT_NewChunk(LT_Context *ctx, size_t size)
+{
+	LT_ArenaChunk *chunk;
+	
+	LT_Reserve(ctx, sizeof(LT_ArenaChunk) + size);
+	chunk = LT_Alloc(ctx, sizeof(LT_ArenaChunk) + size);
+	ctx->memUsed += sizeof(LT_ArenaChunk) + size;
+	
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	
+	return chunk;
+}
+
+static void LT_FreeChunk(LT_Context *ctx, LT_ArenaChunk *chunk)
+{
+	LT_Unreserve(ctx, sizeof(LT_ArenaChunk) + chunk->size);
+	free(chunk);
+}
+
+static void LT_FreeChunks(LT_Context *ctx, LT_ArenaChunk *chunk)
+{
+	while(chunk != NULL)
+	{
+		LT_ArenaChunk *next = chunk->next;
+		
+		LT_FreeChunk(ctx, chunk);
+		chunk = next;
+	}
+}
+
+// Bump-allocates from a list of chunks, newest first. Near the memory
+// limit, a new chunk is only as big as what's asked for.
+static void *LT_ChunkAlloc(LT_Context *ctx, LT_ArenaChunk **arena, size_t size)
+{
+	LT_ArenaChunk *chunk = *arena;
+	size_t start;
+	
+	if(chunk != NULL)
+	{
+		start = (chunk->used + LT_ARENA_ALIGN - 1) & ~(size_t)(LT_ARENA_ALIGN - 1);
+		
+		if(start + size <= chunk->size)
+		{
+			chunk->used = start + size;
+			return chunk->data + start;
+		}
+	}
+	
+	if(chunk != NULL && size > LT_ARENA_CHUNK_LENGTH / 4)
+	{
+		// Big allocations get a chunk of their own behind the current one,
+		// so we don't throw away what's left of it.
+		LT_ArenaChunk *big = LT_NewChunk(ctx, size);
+		
+		big->used = size;
+		big->next = chunk->next;
+		chunk->next = big;
+		
+		return big->data;
+	}
+	
+	chunk = LT_NewChunk(ctx, size > LT_ARENA_CHUNK_LENGTH || !LT_Budget(ctx, sizeof(LT_ArenaChunk) + LT_ARENA_CHUNK_LENGTH) ?
+		size : LT_ARENA_CHUNK_LENGTH);
+	chunk->used = size;
+	chunk->next = *arena;
+	*arena = chunk;
+	
+	return chunk->data;
+}
+
+// Everything the context hands out (token strings, literals, assertion
+// messages) is bump-allocated from a list of large chunks, and freed all at
+// once by LT_ReleaseStrings, LT_Quit or LT_DestroyContext.
+static void *LT_ArenaAlloc(LT_Context *ctx, size_t size)
+{
+	return LT_ChunkAlloc(ctx, &ctx->arena, size);
+}
+
+// Resizes an arena allocation. The most recent allocation is resized in
+// place when it fits, which is the common case for strings being built.
+static void *LT_ArenaReAlloc(LT_Context *ctx, void *ptr, size_t oldSize, size_t newSize)
+{
+	LT_ArenaChunk *chunk = ctx->arena;
+	char *p = ptr;
+	void *newPtr;
+	
+	if(chunk != NULL && p >= chunk->data && p + oldSize == chunk->data + chunk->used)
+	{
+		size_t start = p - chunk->data;
+		
+		if(start + newSize <= chunk->size)
+		{
+			chunk->used = start + newSize;
+			return ptr;
+		}
+	}
+	
+	if(newSize <= oldSize)
+	{
+		return ptr;
+	}
+	
+	newPtr = LT_ArenaAlloc(ctx, newSize);
+	memcpy(newPtr, ptr, oldSize);
+	
+	return newPtr;
+}
+
+// Makes sure str has room for indices 0 to need, doubling it as it grows.
+static char *LT_StrReserve(LT_Context *ctx, char *str, size_t *cap, size_t need)
+{
+	if(need >= *cap)
+	{
+		size_t newCap = *cap;
+		
+		while(need >= newCap)
+		{
+			newCap *= 2;
+		}
+		
+		LT_COUNT(ctx, strGrowths, 1);
+		
+		str = LT_ArenaReAlloc(ctx, str, *cap, newCap);
+		*cap = newCap;
+	}
+	
+	return str;
+}
+
+static char *LT_ArenaStrDup(LT_Context *ctx, const char *src, size_t len)
+{
+	char *str = LT_ArenaAlloc(ctx, len + 1);
+	
+	memcpy(str, src, len);
+	str[len] = '\0';
+	
+	return str;
+}
+
+static void LT_FreeArena(LT_Context *ctx, LT_BOOL keepOne)
+{
+	LT_ArenaChunk *chunk = ctx->arena;
+	
+	ctx->arena = NULL;
+	
+	while(chunk != NULL)
+	{
+		LT_ArenaChunk *next = chunk->next;
+		
+		if(keepOne && ctx->arena == NULL && chunk->size == LT_ARENA_CHUNK_LENGTH)
+		{
+			chunk->used = 0;
+			chunk->next = NULL;
+			ctx->arena = chunk;
+		}
+		else
+		{
+			LT_FreeChunk(ctx, chunk);
+		}
+		
+		chunk = next;
+	}
+}
+
+static LT_ArenaMark LT_MarkArena(LT_Context *ctx)
+{
+	LT_ArenaMark mark;
+	
+	mark.chunk = ctx->arena;
+	mark.next = ctx->arena != NULL ? ctx->arena->next : NULL;
+	mark.used = ctx->arena != NULL ? ctx->arena->used : 0;
+	
+	return mark;
+}
+
+static void LT_RewindArena(LT_Context *ctx, LT_ArenaMark mark)
+{
+	while(ctx->arena != mark.chunk)
+	{
+		LT_ArenaChunk *next = ctx->arena->next;
+		
+		LT_FreeChunk(ctx, ctx->arena);
+		ctx->arena = next;
+	}
+	
+	if(mark.chunk != NULL)
+	{
+		// Big allocations go behind the current chunk.
+		while(mark.chunk->next != mark.next)
+		{
+			LT_ArenaChunk *big = mark.chunk->next;
+			
+			mark.chunk->next = big->next;
+			LT_FreeChunk(ctx, big);
+		}
+		
+		mark.chunk->used = mark.used;
+	}
+}
+
+#ifndef LT_NO_TRACE
+// Monotonic time in nanoseconds.
+static unsigned long long LT_TraceClock(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, now;
+	
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	
+	return (unsigned long long)(now.QuadPart / freq.QuadPart) * 1000000000ull +
+		(unsigned long long)(now.QuadPart % freq.QuadPart) * 1000000000ull / freq.QuadPart;
+#else
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	
+	return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+static inline LT_BOOL LT_Tracing(LT_Context *ctx)
+{
+	return ctx->trace != NULL && ctx->trace->recording;
+}
+
+// Adds an event to the trace, overwriting the oldest one when it's full.
+// start is from LT_TraceClock. A span ends now; an instant has no length.
+static void LT_TraceEvent(LT_Context *ctx, const char *name, char phase, unsigned long long start, size_t count, const char *detail)
+{
+	LT_Trace *trace = ctx->trace;
+	LT_TraceRecord *ev = &trace->events[trace->next];
+	
+	ev->name = name;
+	ev->phase = phase;
+	ev->start = start - trace->origin;
+	ev->dur = phase == 'X' ? LT_TraceClock() - start : 0;
+	ev->count = count;
+	ev->busy = 0;
+	ev->detail[0] = '\0';
+	
+	if(detail != NULL)
+	{
+		strncat(ev->detail, detail, LT_TRACE_DETAIL - 1);
+	}
+	
+	trace->next = (trace->next + 1) % trace->cap;
+	
+	if(trace->count < trace->cap)
+	{
+		trace->count++;
+	}
+}
+
+// Records the LT_GetToken batch so far, if there is one.
+static void LT_TraceFlushBatch(LT_Context *ctx)
+{
+	LT_Trace *trace = ctx->trace;
+	LT_TraceRecord *ev;
+	
+	if(trace->batchTokens == 0)
+	{
+		return;
+	}
+	
+	ev = &trace->events[trace->next];
+	LT_TraceEvent(ctx, "LT_GetToken", 'X', trace->batchStart, trace->batchTokens, NULL);
+	ev->dur = trace->batchEnd - trace->batchStart;
+	ev->busy = trace->batchBusy;
+	
+	trace->batchTokens = 0;
+	trace->batchBusy = 0;
+}
+
+// Adds a token lexed from start until now to the current batch.
+static void LT_TraceToken(LT_Context *ctx, unsigned long long start, LT_BOOL last)
+{
+	LT_Trace *trace = ctx->trace;
+	unsigned long long now = LT_TraceClock();
+	
+	if(trace->batchTokens == 0)
+	{
+		trace->batchStart = start;
+	}
+	
+	trace->batchTokens++;
+	trace->batchBusy += now - start;
+	trace->batchEnd = now;
+	
+	if(trace->batchTokens == LT_TRACE_BATCH || last)
+	{
+		LT_TraceFlushBatch(ctx);
+	}
+}
+#endif
+
+// Terminates a string built with LT_StrReserve and trims it down to size.
+static char *LT_StrFinish(LT_Context *ctx, char *str, size_t cap, size_t len)
+{
+	str[len] = '\0';
+	return LT_ArenaReAlloc(ctx, str, cap, len + 1);
+}
+
+/*
+ * Conversion
+ */
+
+static inline LT_BOOL LT_Converting(LT_Context *ctx)
+{
+#ifndef LT_NO_ICONV
+	return ctx->cfg.doConvert;
+#else
+	return LT_FALSE;
+#endif
+}
+
+#ifndef LT_NO_ICONV
+// Compares encoding names loosely, so "utf8" is "UTF-8".
+static LT_BOOL LT_SameEncoding(const char *a, const char *b)
+{
+	while(*a != '\0' || *b != '\0')
+	{
+		if(*a == '-' || *a == '_')
+		{
+			a++;
+		}
+		else if(*b == '-' || *b == '_')
+		{
+			b++;
+		}
+		else
+		{
+			int ca = (*a >= 'A' && *a <= 'Z') ? *a + 32 : *a;
+			int cb = (*b >= 'A' && *b <= 'Z') ? *b + 32 : *b;
+			
+			if(ca != cb)
+			{
+				return LT_FALSE;
+			}
+			
+			a++;
+			b++;
+		}
+	}
+	
+	return LT_TRUE;
+}
+
+// Returns the length of the byte order mark data starts with, if any, and
+// sets code to the encoding it stands for.
+static size_t LT_DetectBOM(const char *data, size_t len, const char **code)
+{
+	const unsigned char *p = (const unsigned char *)data;
+	
+	if(len >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF)
+	{
+		*code = "UTF-8";
+		return 3;
+	}
+	
+	if(len >= 2 && p[0] == 0xFF && p[1] == 0xFE)
+	{
+		*code = "UTF-16LE";
+		return 2;
+	}
+	
+	if(len >= 2 && p[0] == 0xFE && p[1] == 0xFF)
+	{
+		*code = "UTF-16BE";
+		return 2;
+	}
+	
+	return 0;
+}
+
+static void LT_CloseConverter(LT_Context *ctx)
+{
+	if(ctx->icOpen)
+	{
+		iconv_close(ctx->icDesc);
+		ctx->icOpen = LT_FALSE;
+	}
+	
+	ctx->icFrom = NULL;
+}
+
+// Copies one of the config's encodings, which the caller might free or
+// change once it's been set.
+static char *LT_CopyEncoding(LT_Context *ctx, const char *code)
+{
+	char *copy;
+	
+	if(code == NULL)
+	{
+		return NULL;
+	}
+	
+	copy = LT_Alloc(ctx, strlen(code) + 1);
+	strcpy(copy, code);
+	return copy;
+}
+
+// Gets icDesc ready to convert a new source from fromCode (or the config's
+// fromCode if NULL) to toCode. Both default to UTF-8.
+static LT_BOOL LT_OpenConverter(LT_Context *ctx, const char *fromCode)
+{
+	const char *toCode = ctx->cfg.toCode != NULL ? ctx->cfg.toCode : "UTF-8";
+	
+	if(fromCode == NULL)
+	{
+		fromCode = ctx->cfg.fromCode != NULL ? ctx->cfg.fromCode : "UTF-8";
+	}
+	
+	if(ctx->icFrom != NULL && strcmp(ctx->icFrom, fromCode) == 0)
+	{
+		if(ctx->icOpen)
+		{
+			iconv(ctx->icDesc, NULL, NULL, NULL, NULL);
+		}
+		
+		return LT_TRUE;
+	}
+	
+	LT_CloseConverter(ctx);
+	
+	if(!LT_SameEncoding(fromCode, toCode))
+	{
+		ctx->icDesc = iconv_open(toCode, fromCode);
+		
+		if(ctx->icDesc == (iconv_t) -1)
+		{
+			return LT_FALSE;
+		}
+		
+		ctx->icOpen = LT_TRUE;
+	}
+	
+	ctx->icFrom = fromCode;
+	return LT_TRUE;
+}
+
+// Converts len bytes of src into a new buffer. If more is to come, a
+// character cut off at the end is left for next time, and used says how
+// much of src was converted. Bytes that can't be converted become '?'.
+// The buffer is kept under memLimit as it grows; if it can't be, this
+// raises LT_ERR_MEMORY for func and returns NULL.
+static char *LT_ConvertInput(LT_Context *ctx, const char *func, const char *src, size_t len, LT_BOOL more, size_t *outLen, size_t *used)
+{
+	size_t cap = len + len / 2 + 16, inLeft = len, outLeft = cap, done;
+	char *str = LT_TryReAlloc(ctx, NULL, cap);
+	char *in = (char *)src, *out = str, *grown;
+	
+#ifndef LT_NO_TRACE
+	unsigned long long start = LT_Tracing(ctx) ? LT_TraceClock() : 0;
+#endif
+	
+	if(LT_Raise(ctx, str == NULL, func, LT_ERR_MEMORY, (long)cap, NULL))
+	{
+		return NULL;
+	}
+	
+	LT_COUNT(ctx, conversions, 1);
+	
+	while(inLeft != 0 && iconv(ctx->icDesc, &in, &inLeft, &out, &outLeft) == (size_t) -1)
+	{
+		if(errno == EINVAL && more && inLeft <= LT_FEED_PENDING)
+		{
+			break;
+		}
+		
+		if(errno != E2BIG && outLeft != 0)
+		{
+			*out++ = '?';
+			outLeft--;
+			in++;
+			inLeft--;
+			continue;
+		}
+		
+		done = out - str;
+		
+		if(LT_Raise(ctx, (grown = LT_TryReAlloc(ctx, str, cap * 2)) == NULL, func, LT_ERR_MEMORY, (long)(cap * 2), NULL))
+		{
+			free(str);
+			return NULL;
+		}
+		
+		str = grown;
+		cap *= 2;
+		out = str + done;
+		outLeft = cap - done;
+	}
+	
+#ifndef LT_NO_TRACE
+	if(LT_Tracing(ctx))
+	{
+		LT_TraceEvent(ctx, "LT_ConvertInput", 'X', start, len, NULL);
+	}
+#endif
+	
+	*outLen = out - str;
+	*used = in - src;
+	return str;
+}
+
+// Converts a newly opened source all at once, so tokens never need to be.
+static LT_BOOL LT_ConvertSource(LT_Context *ctx, const char *func)
+{
+	const char *code = NULL;
+	size_t bom = LT_DetectBOM(ctx->buf, ctx->bufLen, &code), len, used;
+	char *str;
+	
+	if(!LT_OpenConverter(ctx, code))
+	{
+		LT_Raise(ctx, LT_TRUE, func, LT_ERR_ICONV, 0, code);
+		LT_CloseFileCtx(ctx);
+		return LT_FALSE;
+	}
+	
+	ctx->buf += bom;
+	ctx->bufLen -= bom;
+	
+	if(!ctx->icOpen)
+	{
+		return LT_TRUE;
+	}
+	
+	str = LT_ConvertInput(ctx, func, ctx->buf, ctx->bufLen, LT_FALSE, &len, &used);
+	
+	LT_CloseFileCtx(ctx);
+	
+	if(str == NULL)
+	{
+		return LT_FALSE;
+	}
+	
+	LT_OwnBuffer(ctx, str, len);
+	ctx->buf = str;
+	ctx->bufLen = len;
+	
+	return LT_TRUE;
+}
+#endif
+
+/*
+ * Lines
+ */
+
+static void LT_GrowLines(LT_Context *ctx, size_t count)
+{
+	if(count > ctx->lineCap)
+	{
+		size_t newCap = ctx->lineCap ? ctx->lineCap : 256;
+		
+		while(newCap < count)
+		{
+			newCap *= 2;
+		}
+		
+		LT_Reserve(ctx, (newCap - ctx->lineCap) * sizeof(size_t));
+		ctx->lineStarts = LT_ReAlloc(ctx, ctx->lineStarts, newCap * sizeof(size_t));
+		ctx->memUsed += (newCap - ctx->lineCap) * sizeof(size_t);
+		ctx->lineCap = newCap;
+	}
+}
+
+static void LT_AddLine(LT_Context *ctx, size_t start)
+{
+	LT_GrowLines(ctx, ctx->lineCount + 1);
+	ctx->lineStarts[ctx->lineCount++] = start;
+}
+
+// Called by LT_ReadC after a newline is read from a file. Lines are only
+// added in order, so reading one again after seeking back does nothing.
+static void LT_NoteLine(LT_Context *ctx)
+{
+	long at = ftell(ctx->parseFile);
+	
+	if(ctx->lineCount == 0)
+	{
+		LT_AddLine(ctx, 0);
+	}
+	
+	if(at > 0 && (size_t)at > ctx->lineStarts[ctx->lineCount - 1])
+	{
+		LT_AddLine(ctx, (size_t)at);
+	}
+}
+
+// Makes sure every line starting at or before upto is in the index. A
+// buffer is searched a block at a time with memchr; a file has had its
+// lines noted by LT_ReadC as far as it's been read.
+static void LT_IndexLines(LT_Context *ctx, size_t upto)
+{
+	if(ctx->lineCount == 0)
+	{
+		LT_AddLine(ctx, 0);
+	}
+	
+	if(ctx->buf != NULL && upto > ctx->lineScanned)
+	{
+		const char *nl;
+		size_t pos = ctx->lineScanned - ctx->streamBase, end = ctx->bufLen;
+		
+		if(end > LT_LINE_BLOCK && upto - ctx->streamBase < end - LT_LINE_BLOCK)
+		{
+			end = upto - ctx->streamBase + LT_LINE_BLOCK;
+		}
+		
+		while(pos < end && (nl = memchr(ctx->buf + pos, '\n', end - pos)) != NULL)
+		{
+			pos = (size_t)(nl - ctx->buf) + 1;
+			LT_AddLine(ctx, ctx->streamBase + pos);
+			ctx->lineScanned = ctx->streamBase + pos;
+		}
+		
+		ctx->lineScanned = ctx->streamBase + end;
+	}
+	else if(ctx->buf == NULL && ctx->parseFile != NULL)
+	{
+		long at = ftell(ctx->parseFile);
+		
+		if(at > 0 && (size_t)at > ctx->lineScanned)
+		{
+			ctx->lineScanned = (size_t)at;
+		}
+	}
+}
+
+// Finds the line an indexed offset is on. Offsets mostly come in order, so
+// the last line found and the one after it are tried before searching.
+static size_t LT_LineOf(LT_Context *ctx, size_t offset)
+{
+	const size_t *starts = ctx->lineStarts;
+	size_t lo = ctx->lineHint, hi = ctx->lineCount;
+	
+	if(lo < hi && starts[lo] <= offset)
+	{
+		if(lo + 1 == hi || offset < starts[lo + 1])
+		{
+			return lo;
+		}
+		
+		if(lo + 2 == hi || offset < starts[lo + 2])
+		{
+			return ctx->lineHint = lo + 1;
+		}
+		
+		lo += 2;
+	}
+	else
+	{
+		lo = 0;
+	}
+	
+	while(hi - lo > 1)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		
+		if(starts[mid] <= offset)
+		{
+			lo = mid;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	
+	return ctx->lineHint = lo;
+}
+
+// Gives a token the line and column its pos is at, both from 1.
+static void LT_TokenLine(LT_Context *ctx, LT_Token *tk)
+{
+	size_t line;
+	
+	LT_IndexLines(ctx, (size_t)tk->pos);
+	line = LT_LineOf(ctx, (size_t)tk->pos);
+	
+	tk->line = (int)line + 1;
+	tk->col = (int)((size_t)tk->pos - ctx->lineStarts[line]) + 1;
+}
+
+/*
+ * Reading
+ */
+
+static inline int LT_ReadC(LT_Context *ctx)
+{
+	int c;
+	
+	if(ctx->buf != NULL)
+	{
+		if(ctx->bufPos < ctx->bufLen)
+		{
+			return (unsigned char)ctx->buf[ctx->bufPos++];
+		}
+		
+		ctx->hitEnd = LT_TRUE;
+		return EOF;
+	}
+	
+	if(ctx->parseFile == NULL)
+	{
+		return EOF;
+	}
+	
+	if((c = fgetc(ctx->parseFile)) == '\n')
+	{
+		LT_NoteLine(ctx);
+	}
+	
+	return c;
+}
+
+static inline void LT_UnreadC(LT_Context *ctx, int c)
+{
+	if(ctx->buf != NULL)
+	{
+		if(c != EOF)
+		{
+			ctx->bufPos--;
+		}
+	}
+	else if(ctx->parseFile != NULL)
+	{
+		ungetc(c, ctx->parseFile);
+	}
+}
+
+static inline long LT_Tell(LT_Context *ctx)
+{
+	if(ctx->buf != NULL)
+	{
+		return (long)ctx->bufPos;
+	}
+	
+	return ctx->parseFile != NULL ? ftell(ctx->parseFile) : -1;
+}
+
+#ifndef __GDCC__
+// Reads the rest of fp into a new buffer. The buffer is kept under memLimit
+// as it grows; if it can't be, this raises LT_ERR_MEMORY for func and
+// returns NULL.
+static char *LT_ReadWholeFile(LT_Context *ctx, const char *func, FILE *fp, size_t *size)
+{
+	size_t len = 0, cap = TOKEN_STR_BLOCK_LENGTH, n;
+	char *data = LT_TryReAlloc(ctx, NULL, cap), *grown;
+	
+	if(LT_Raise(ctx, data == NULL, func, LT_ERR_MEMORY, (long)cap, NULL))
+	{
+		return NULL;
+	}
+	
+	while((n = fread(data + len, 1, cap - len, fp)) != 0)
+	{
+		len += n;
+		
+		if(len == cap)
+		{
+			if(LT_Raise(ctx, (grown = LT_TryReAlloc(ctx, data, cap * 2)) == NULL, func, LT_ERR_MEMORY, (long)(cap * 2), NULL))
+			{
+				free(data);
+				return NULL;
+			}
+			
+			data = grown;
+			cap *= 2;
+		}
+	}
+	
+	*size = len;
+	return data;
+}
+
+#ifndef LT_NO_MMAP
+// Maps a whole file into memory read-only. Returns LT_FALSE with errno set
+// if it can't be opened. Otherwise *base is NULL if it can't be mapped, and
+// the caller should read it instead: a size of 0 isn't trusted, since pipes
+// and files like those in /proc say they're empty when they aren't.
+static LT_BOOL LT_MapWhole(const char *filePath, void **base, size_t *size)
+{
+#ifdef _WIN32
+	HANDLE file, mapping;
+	LARGE_INTEGER fileSize;
+	
+	*base = NULL;
+	file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		errno = ENOENT;
+		return LT_FALSE;
+	}
+	
+	if(!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		errno = EIO;
+		return LT_FALSE;
+	}
+	
+	*size = (size_t)fileSize.QuadPart;
+	
+	if(*size == 0 || GetFileType(file) != FILE_TYPE_DISK)
+	{
+		CloseHandle(file);
+		return LT_TRUE;
+	}
+	
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	
+	if(mapping != NULL)
+	{
+		*base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+	}
+	
+	return LT_TRUE;
+#else
+	struct stat st;
+	int fd;
+	
+	*base = NULL;
+	*size = 0;
+	
+	// Don't open anything that isn't a plain file here, so a FIFO's writer
+	// doesn't see it opened and closed before it's read.
+	if(stat(filePath, &st) != 0)
+	{
+		return LT_FALSE;
+	}
+	
+	if(!S_ISREG(st.st_mode) || st.st_size == 0)
+	{
+		return LT_TRUE;
+	}
+	
+	if((fd = open(filePath, O_RDONLY)) < 0)
+	{
+		return LT_FALSE;
+	}
+	
+	if(fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return LT_FALSE;
+	}
+	
+	*size = (size_t)st.st_size;
+	
+	if(S_ISREG(st.st_mode) && *size != 0)
+	{
+		*base = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+		
+		if(*base == MAP_FAILED)
+		{
+			*base = NULL;
+		}
+	}
+	
+	close(fd);
+	return LT_TRUE;
+#endif
+}
+
+static void LT_Unmap(void *base, size_t size)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(base);
+#else
+	munmap(base, size);
+#endif
+}
+#endif
+
+// Maps a whole file into memory read-only. Falls back to reading it in
+// if mapping isn't available on this platform or for this file. Raises
+// LT_ERR_SYSTEM if it can't be opened, or LT_ERR_MEMORY if it's read and
+// won't fit under memLimit.
+static LT_BOOL LT_MapFile(LT_Context *ctx, const char *filePath)
+{
+	FILE *fp;
+	char *data;
+	
+#ifndef LT_NO_MMAP
+	void *base;
+	
+	if(!LT_MapWhole(filePath, &base, &ctx->bufLen))
+	{
+		LT_Raise(ctx, LT_TRUE, "LT_OpenFile", LT_ERR_SYSTEM, errno, NULL);
+		return LT_FALSE;
+	}
+	
+	if(base != NULL)
+	{
+		ctx->mapBase = base;
+		ctx->mapLen = ctx->bufLen;
+		ctx->buf = base;
+		return LT_TRUE;
+	}
+#endif
+	
+	if((fp = fopen(filePath, "rb")) == NULL)
+	{
+		LT_Raise(ctx, LT_TRUE, "LT_OpenFile", LT_ERR_SYSTEM, errno, NULL);
+		return LT_FALSE;
+	}
+	
+	data = LT_ReadWholeFile(ctx, "LT_OpenFile", fp, &ctx->bufLen);
+	fclose(fp);
+	
+	if(data == NULL)
+	{
+		return LT_FALSE;
+	}
+	
+	LT_OwnBuffer(ctx, data, ctx->bufLen);
+	ctx->buf = ctx->bufOwned;
+	return LT_TRUE;
+}
+#endif
+
+static inline LT_BOOL LT_UseSpans(LT_Context *ctx)
+{
+	return ctx->buf != NULL && ctx->cfg.spanTokens && !ctx->streaming;
+}
+
+static void LT_CharToken(LT_Context *ctx, LT_Token *tk, int c)
+{
+	tk->kind = TOK_ChrSeq;
+	tk->spanPos = tk->pos;
+	tk->spanLen = tk->strlen = 1;
+	
+	if(!LT_UseSpans(ctx))
+	{
+		tk->string = LT_ArenaAlloc(ctx, 2);
+		tk->string[0] = c;
+		tk->string[1] = '\0';
+	}
+}
+
+/*
+ * Scanning kernels
+ */
+
+static inline LT_BOOL LT_InScanSet(int set, unsigned char c)
+{
+	LT_BOOL space = c == ' ' || (unsigned)(c - '\t') <= '\r' - '\t';
+	LT_BOOL alnum = (unsigned)(c - '0') <= 9 || (unsigned)((c | 0x20) - 'a') <= 'z' - 'a';
+	
+	switch(set)
+	{
+	case LT_SCAN_SPACE:  return space;
+	case LT_SCAN_BLANK:  return space && c != '\n';
+	case LT_SCAN_BLANK2: return space && c != '\n' && c != '\r';
+	case LT_SCAN_IDENT:  return alnum || c == '_';
+	case LT_SCAN_NUMBER: return alnum || c == '.';
+	case LT_SCAN_TEXT:   return space || (unsigned)(c - ' ') <= '~' - ' ';
+	}
+	
+	return LT_FALSE;
+}
+
+static inline const char *LT_ScanScalar(int set, const char *p, const char *end)
+{
+	while(p < end && LT_InScanSet(set, (unsigned char)*p))
+	{
+		p++;
+	}
+	
+	return p;
+}
+
+#ifdef LT_HAVE_SSE2
+static inline unsigned LT_CountTrailingZeros(unsigned x)
+{
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanForward(&i, x);
+	return (unsigned)i;
+#else
+	return (unsigned)__builtin_ctz(x);
+#endif
+}
+
+// Sets each byte of the result to 0xFF if the byte in x is in the set.
+// The ranges are checked with unsigned min, since SSE2 has no unsigned
+// compare: x is in [0, n] if min(x, n) == x.
+static inline __m128i LT_MatchSSE2(int set, __m128i x)
+{
+	__m128i m;
+	
+	if(set == LT_SCAN_IDENT || set == LT_SCAN_NUMBER)
+	{
+		__m128i d = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+		__m128i a = _mm_sub_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+		
+		m = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d),
+		                 _mm_cmpeq_epi8(_mm_min_epu8(a, _mm_set1_epi8('z' - 'a')), a));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8(set == LT_SCAN_IDENT ? '_' : '.')));
+	}
+	else if(set == LT_SCAN_TEXT)
+	{
+		__m128i t = _mm_sub_epi8(x, _mm_set1_epi8(' '));
+		__m128i w = _mm_sub_epi8(x, _mm_set1_epi8('\t'));
+		
+		m = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8('~' - ' ')), t),
+		                 _mm_cmpeq_epi8(_mm_min_epu8(w, _mm_set1_epi8('\r' - '\t')), w));
+	}
+	else
+	{
+		__m128i w = _mm_sub_epi8(x, _mm_set1_epi8('\t'));
+		
+		m = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+		                 _mm_cmpeq_epi8(_mm_min_epu8(w, _mm_set1_epi8('\r' - '\t')), w));
+		
+		if(set != LT_SCAN_SPACE)
+		{
+			m = _mm_andnot_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')), m);
+		}
+		
+		if(set == LT_SCAN_BLANK2)
+		{
+			m = _mm_andnot_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\r')), m);
+		}
+	}
+	
+	return m;
+}
+
+static inline const char *LT_ScanSSE2(int set, const char *p, const char *end)
+{
+	while(end - p >= 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i *)p);
+		unsigned miss = ~(unsigned)_mm_movemask_epi8(LT_MatchSSE2(set, x)) & 0xFFFFu;
+		
+		if(miss != 0)
+		{
+			return p + LT_CountTrailingZeros(miss);
+		}
+		
+		p += 16;
+	}
+	
+	return LT_ScanScalar(set, p, end);
+}
+#endif
+
+#ifdef LT_HAVE_AVX2
+#define LT_TARGET_AVX2 __attribute__((target("avx2")))
+
+// Same as LT_MatchSSE2, 32 bytes at a time.
+static inline LT_TARGET_AVX2 __m256i LT_MatchAVX2(int set, __m256i x)
+{
+	__m256i m;
+	
+	if(set == LT_SCAN_IDENT || set == LT_SCAN_NUMBER)
+	{
+		__m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8('0'));
+		__m256i a = _mm256_sub_epi8(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+		
+		m = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d),
+		                    _mm256_cmpeq_epi8(_mm256_min_epu8(a, _mm256_set1_epi8('z' - 'a')), a));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8(set == LT_SCAN_IDENT ? '_' : '.')));
+	}
+	else if(set == LT_SCAN_TEXT)
+	{
+		__m256i t = _mm256_sub_epi8(x, _mm256_set1_epi8(' '));
+		__m256i w = _mm256_sub_epi8(x, _mm256_set1_epi8('\t'));
+		
+		m = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8('~' - ' ')), t),
+		                    _mm256_cmpeq_epi8(_mm256_min_epu8(w, _mm256_set1_epi8('\r' - '\t')), w));
+	}
+	else
+	{
+		__m256i w = _mm256_sub_epi8(x, _mm256_set1_epi8('\t'));
+		
+		m = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+		                    _mm256_cmpeq_epi8(_mm256_min_epu8(w, _mm256_set1_epi8('\r' - '\t')), w));
+		
+		if(set != LT_SCAN_SPACE)
+		{
+			m = _mm256_andnot_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')), m);
+		}
+		
+		if(set == LT_SCAN_BLANK2)
+		{
+			m = _mm256_andnot_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r')), m);
+		}
+	}
+	
+	return m;
+}
+
+static inline LT_TARGET_AVX2 const char *LT_ScanAVX2(int set, const char *p, const char *end)
+{
+	while(end - p >= 32)
+	{
+		__m256i x = _mm256_loadu_si256((const __m256i *)p);
+		unsigned miss = ~(unsigned)_mm256_movemask_epi8(LT_MatchAVX2(set, x));
+		
+		if(miss != 0)
+		{
+			return p + LT_CountTrailingZeros(miss);
+		}
+		
+		p += 32;
+	}
+	
+	return LT_ScanSSE2(set, p, end);
+}
+#endif
+
+// Spits out a kernel for each set, so the set gets folded into the code.
+#define LT_DefScanKernels(isa, attr) \
+	static attr const char *LT_ScanSpace##isa(const char *p, const char *end)  { return LT_Scan##isa(LT_SCAN_SPACE,  p, end); } \
+	static attr const char *LT_ScanBlank##isa(const char *p, const char *end)  { return LT_Scan##isa(LT_SCAN_BLANK,  p, end); } \
+	static attr const char *LT_ScanBlank2##isa(const char *p, const char *end) { return LT_Scan##isa(LT_SCAN_BLANK2, p, end); } \
+	static attr const char *LT_ScanIdent##isa(const char *p, const char *end)  { return LT_Scan##isa(LT_SCAN_IDENT,  p, end); } \
+	static attr const char *LT_ScanNumber##isa(const char *p, const char *end) { return LT_Scan##isa(LT_SCAN_NUMBER, p, end); } \
+	static attr const char *LT_ScanText##isa(const char *p, const char *end)   { return LT_Scan##isa(LT_SCAN_TEXT,   p, end); } \
+	\
+	static const LT_ScanFunc ltScan##isa[LT_SCAN_MAX] = { \
+		LT_ScanSpace##isa, LT_ScanBlank##isa, LT_ScanBlank2##isa, LT_ScanIdent##isa, LT_ScanNumber##isa, LT_ScanText##isa \
+	};
+
+#ifdef LT_HAVE_SSE2
+LT_DefScanKernels(SSE2, )
+#else
+LT_DefScanKernels(Scalar, )
+#endif
+
+#ifdef LT_HAVE_AVX2
+LT_DefScanKernels(AVX2, LT_TARGET_AVX2)
+#endif
+
+#undef LT_DefScanKernels
+
+static const LT_ScanFunc *LT_SelectScanKernels(void)
+{
+#ifdef LT_HAVE_AVX2
+	__builtin_cpu_init();
+	
+	if(__builtin_cpu_supports("avx2"))
+	{
+		return ltScanAVX2;
+	}
+#endif
+	
+#ifdef LT_HAVE_SSE2
+	return ltScanSSE2;
+#else
+	return ltScanScalar;
+#endif
+}
+
+/*
+ * Stripping
+ */
+
+// Returns the length of the valid UTF-8 sequence at p, or 0 if there isn't
+// one. partial is set if that's only because end cuts it off.
+static size_t LT_UTF8Length(const char *p, const char *end, LT_BOOL *partial)
+{
+	const unsigned char *s = (const unsigned char *)p;
+	unsigned char lo = 0x80, hi = 0xBF;
+	size_t n, i;
+	
+	*partial = LT_FALSE;
+	
+	if(s[0] >= 0xC2 && s[0] <= 0xDF)
+	{
+		n = 2;
+	}
+	else if(s[0] >= 0xE0 && s[0] <= 0xEF)
+	{
+		n = 3;
+		lo = s[0] == 0xE0 ? 0xA0 : 0x80; // overlong
+		hi = s[0] == 0xED ? 0x9F : 0xBF; // surrogates
+	}
+	else if(s[0] >= 0xF0 && s[0] <= 0xF4)
+	{
+		n = 4;
+		lo = s[0] == 0xF0 ? 0x90 : 0x80; // overlong
+		hi = s[0] == 0xF4 ? 0x8F : 0xBF; // past U+10FFFF
+	}
+	else
+	{
+		return 0;
+	}
+	
+	for(i = 1; i < n; i++, lo = 0x80, hi = 0xBF)
+	{
+		if(p + i == end)
+		{
+			*partial = LT_TRUE;
+			return 0;
+		}
+		
+		if(s[i] < lo || s[i] > hi)
+		{
+			return 0;
+		}
+	}
+	
+	return n;
+}
+
+// Skips text stripInvalid leaves alone: printable ASCII, whitespace and
+// valid UTF-8. Plain ASCII is skipped a vector at a time.
+static const char *LT_SkipValid(LT_Context *ctx, const char *p, const char *end)
+{
+	while((p = ctx->scan[LT_SCAN_TEXT](p, end)) != end)
+	{
+		LT_BOOL partial;
+		size_t n = LT_UTF8Length(p, end, &partial);
+		
+		if(n == 0)
+		{
+			break;
+		}
+		
+		p += n;
+	}
+	
+	return p;
+}
+
+// Replaces every byte LT_SkipValid stops at with a space. If more is to
+// come, a UTF-8 sequence cut off at the end is left alone, and the length
+// before it is returned.
+static size_t LT_StripInvalid(LT_Context *ctx, char *buf, size_t len, LT_BOOL more)
+{
+	char *p = buf, *end = buf + len;
+	
+	while((p = (char *)LT_SkipValid(ctx, p, end)) != end)
+	{
+		LT_BOOL partial;
+		
+		LT_UTF8Length(p, end, &partial);
+		
+		if(partial && more)
+		{
+			return p - buf;
+		}
+		
+		*p++ = ' ';
+	}
+	
+	return len;
+}
+
+// Strips a newly opened source, copying it only if it needs changing and
+// isn't the context's own.
+static LT_BOOL LT_StripSource(LT_Context *ctx, const char *func)
+{
+	size_t len = ctx->bufLen, first = LT_SkipValid(ctx, ctx->buf, ctx->buf + len) - ctx->buf;
+	
+	if(first == len)
+	{
+		return LT_TRUE;
+	}
+	
+	if(ctx->bufOwned == NULL)
+	{
+		char *str;
+		
+		if(LT_Raise(ctx, !LT_Budget(ctx, len), func, LT_ERR_MEMORY, (long)len, NULL))
+		{
+			LT_CloseFileCtx(ctx);
+			return LT_FALSE;
+		}
+		
+		str = LT_Alloc(ctx, len);
+		memcpy(str, ctx->buf, len);
+		LT_CloseFileCtx(ctx);
+		LT_OwnBuffer(ctx, str, len);
+		ctx->buf = str;
+		ctx->bufLen = len;
+	}
+	
+	LT_StripInvalid(ctx, (char *)ctx->buf + first, len - first, LT_FALSE);
+	return LT_TRUE;
+}
+
+// Builds the character tables. These only use the "C" locale rules, so
+// setlocale can't change how things get lexed.
+static void LT_BuildCharTables(LT_Context *ctx)
+{
+	const char *stringChars = ctx->cfg.stringChars != NULL ? ctx->cfg.stringChars : "\"";
+	const char *charChars = ctx->cfg.charChars != NULL ? ctx->cfg.charChars : "'";
+	unsigned i;
+	
+	for(i = 0; i < 256; i++)
+	{
+		LT_BOOL space = LT_InScanSet(LT_SCAN_SPACE, i);
+		LT_BOOL digit = i >= '0' && i <= '9';
+		LT_BOOL alpha = (i | 0x20) - 'a' <= 'z' - 'a';
+		unsigned char flags = 0;
+		
+		if(space)                            flags |= LT_CF_SPACE | LT_CF_PRINT;
+		if(LT_InScanSet(LT_SCAN_IDENT, i))   flags |= LT_CF_IDENT;
+		if(LT_InScanSet(LT_SCAN_NUMBER, i))  flags |= LT_CF_NUMBER;
+		if(i >= ' ' && i < 0x7F)             flags |= LT_CF_PRINT;
+		
+		ctx->charFlags[i] = flags;
+		
+		if(i != '\0' && strchr(ltOpChars, i) != NULL)
+		{
+			ctx->charClass[i] = LT_CC_OPER;
+		}
+		else if(space)
+		{
+			ctx->charClass[i] = LT_CC_SPACE;
+		}
+		else if(digit)
+		{
+			ctx->charClass[i] = LT_CC_DIGIT;
+		}
+		else if(alpha || i == '_')
+		{
+			ctx->charClass[i] = LT_CC_IDENT;
+		}
+		else
+		{
+			ctx->charClass[i] = LT_CC_OTHER;
+		}
+	}
+	
+	// Quote characters come before numbers and identifiers, but operators
+	// and whitespace still win, and string quotes win over character quotes.
+	for(i = 0; i < 6 && charChars[i] != '\0'; i++)
+	{
+		unsigned char c = charChars[i];
+		
+		if(ctx->charClass[c] != LT_CC_OPER && ctx->charClass[c] != LT_CC_SPACE)
+		{
+			ctx->charClass[c] = LT_CC_CHAR;
+		}
+	}
+	
+	for(i = 0; i < 6 && stringChars[i] != '\0'; i++)
+	{
+		unsigned char c = stringChars[i];
+		
+		if(ctx->charClass[c] != LT_CC_OPER && ctx->charClass[c] != LT_CC_SPACE)
+		{
+			ctx->charClass[c] = LT_CC_STRING;
+		}
+	}
+}
+
+static void LT_BuildKeywords(LT_Context *ctx);
+static void LT_FreeKeywords(LT_Context *ctx);
+
+// The default context can be used before LT_Init (e.g. LT_OpenFile first),
+// so make sure it at least has a valid default configuration.
+static LT_Context *LT_Default(void)
+{
+	if(!defaultCtx.ready)
+	{
+		LT_Config initCfg = { 0 };
+		LT_SetConfigCtx(&defaultCtx, initCfg);
+	}
+	
+	return &defaultCtx;
+}
+
+// Releases everything owned by a context and resets it, but doesn't free it.
+static void LT_FreeContext(LT_Context *ctx)
+{
+#ifndef LT_NO_ICONV
+	LT_CloseConverter(ctx);
+	free(ctx->fromCode);
+	free(ctx->toCode);
+	ctx->fromCode = ctx->toCode = NULL;
+#endif
+	
+	LT_CloseFileCtx(ctx);
+	
+	LT_Unreserve(ctx, ctx->lineCap * sizeof(size_t));
+	free(ctx->lineStarts);
+	ctx->lineStarts = NULL;
+	ctx->lineCap = 0;
+	
+	LT_FreeArena(ctx, LT_FALSE);
+	
+	LT_FreeChunks(ctx, ctx->symArena);
+	LT_Unreserve(ctx, ctx->symSlotCount * sizeof(unsigned) + ctx->symCap * sizeof(LT_Symbol));
+	free(ctx->symSlots);
+	free(ctx->symbols);
+	ctx->symArena = NULL;
+	ctx->symSlots = NULL;
+	ctx->symbols = NULL;
+	ctx->symSlotCount = ctx->symCount = ctx->symCap = 0;
+	
+	LT_FreeKeywords(ctx);
+	
+	LT_ClearErrorsCtx(ctx);
+	ctx->ready = LT_FALSE;
+	
+	LT_ResetStatsCtx(ctx);
+	
+#ifndef LT_NO_TRACE
+	if(ctx->trace != NULL)
+	{
+		free(ctx->trace->events);
+		free(ctx->trace);
+		ctx->trace = NULL;
+	}
+#endif
+}
+
+#ifdef __GDCC__
+#define StrParam(...) \
+	( \
+		ACS_BeginStrParam(), \
+		__nprintf(__VA_ARGS__), \
+		ACS_EndStrParam() \
+	)
+#define StrParamL(...) (StrParam("%LS", StrParam(__VA_ARGS__)))
+
+LT_File *LT_FOpen(__str languageId, const char *mode)
+{
+	LT_File *file = LT_Alloc(NULL, sizeof(LT_File));
+	
+	file->langId = languageId;
+	file->data = StrParamL("%S", languageId);
+	file->pos = 0;
+	
+	return file;
+}
+
+int LT_FTell(LT_File *file)
+{
+	return file->pos;
+}
+
+int LT_FGetC(LT_File *file)
+{
+	int c = ACS_GetChar(file->data, file->pos++);
+	return c < 1 ? EOF : c;
+}
+
+int LT_UnGetC(int ch, LT_File *file)
+{
+	int c = ACS_GetChar(file->data, file->pos--);
+	return c < 1 ? EOF : c;
+}
+
+int LT_FSeek(LT_File *file, long int offset, int whence)
+{
+	switch(whence)
+	{
+	case SEEK_SET:
+		file->pos = offset;
+		return 0;
+	case SEEK_CUR:
+		file->pos += offset;
+		return 0;
+	case SEEK_END:
+		file->pos = ACS_StrLen(file->data) + offset;
+		return 0;
+	}
+	
+	return 1;
+}
+
+int LT_FClose(LT_File *file)
+{
+	free(file);
+	return 0;
+}
+#endif
+
+LT_Context *LT_CreateContext(LT_Config initCfg)
+{
+	LT_Context *ctx = LT_Alloc(NULL, sizeof(LT_Context));
+	
+	memset(ctx, 0, sizeof(LT_Context));
+	LT_SetConfigCtx(ctx, initCfg);
+	
+	return ctx;
+}
+
+void LT_SetConfigCtx(LT_Context *ctx, LT_Config newCfg)
+{
+#ifndef LT_NO_ICONV
+	// The config might point at our current copies, so make the new ones
+	// first.
+	char *fromCode = LT_CopyEncoding(ctx, newCfg.fromCode), *toCode = LT_CopyEncoding(ctx, newCfg.toCode);
+#endif
+	
+	ctx->cfg = newCfg;
+	
+#ifndef LT_NO_ICONV
+	LT_CloseConverter(ctx);
+	
+	free(ctx->fromCode);
+	free(ctx->toCode);
+	ctx->cfg.fromCode = ctx->fromCode = fromCode;
+	ctx->cfg.toCode = ctx->toCode = toCode;
+	
+	if(ctx->cfg.doConvert && !LT_OpenConverter(ctx, NULL))
+	{
+		LT_Raise(ctx, LT_TRUE, "LT_Init", LT_ERR_ICONV, 0, NULL);
+		ctx->cfg.doConvert = LT_FALSE;
+	}
+	
+	if(ctx->cfg.stripInvalid && ctx->cfg.doConvert)
+	{
+		ctx->cfg.stripInvalid = LT_FALSE;
+	}
+#endif
+	
+	LT_BuildCharTables(ctx);
+	LT_BuildKeywords(ctx);
+	ctx->scan = LT_SelectScanKernels();
+	
+	ctx->ready = LT_TRUE;
+}
+
+void LT_DestroyContext(LT_Context *ctx)
+{
+	if(ctx != NULL)
+	{
+		LT_FreeContext(ctx);
+		free(ctx);
+	}
+}
+
+// Frees every string handed out so far at once, keeping one chunk around
+// for reuse. Errors are cleared along with them.
+void LT_ReleaseStringsCtx(LT_Context *ctx)
+{
+	LT_FreeArena(ctx, LT_TRUE);
+	LT_ClearErrorsCtx(ctx);
+}
+
+void LT_ReleaseStrings()
+{
+	LT_ReleaseStringsCtx(&defaultCtx);
+}
+
+void LT_Init(LT_Config initCfg)
+{
+	LT_SetConfigCtx(&defaultCtx, initCfg);
+}
+
+void LT_SetConfig(LT_Config newCfg)
+{
+	LT_SetConfigCtx(&defaultCtx, newCfg);
+}
+
+void LT_Quit()
+{
+	LT_FreeContext(&defaultCtx);
+}
+
+// Adds an error to the ring, overwriting the oldest one if it's full.
+static void LT_PushError(LT_Context *ctx, const LT_ErrorInfo *err)
+{
+	ctx->errorRing[ctx->assertCount % LT_ERROR_RING] = *err;
+	ctx->assertCount++;
+	ctx->assertError = LT_TRUE;
+}
+
+// Records an error at pos in the source if assertion is true, and returns
+// assertion. Nothing is allocated or formatted, so the error path is as
+// cheap as lexing; the line and column are found by LT_PlaceErrors.
+static LT_BOOL LT_RaiseAt(LT_Context *ctx, LT_BOOL assertion, long pos, const char *func, int code, long arg, const char *detail)
+{
+	if(assertion)
+	{
+		LT_ErrorInfo err;
+		
+		err.code = code;
+		err.func = func;
+		err.offset = pos;
+		err.arg = arg;
+		err.detail = detail;
+		
+		err.line = err.col = 0;
+		
+		if(err.offset >= 0)
+		{
+			err.offset += (long)ctx->streamBase;
+		}
+		
+		LT_PushError(ctx, &err);
+		LT_COUNT(ctx, asserts, 1);
+		
+#ifndef LT_NO_TRACE
+		if(LT_Tracing(ctx))
+		{
+			char text[LT_TRACE_DETAIL];
+			
+			LT_FormatError(&err, text, sizeof(text));
+			LT_TraceEvent(ctx, "LT_Assert", 'i', LT_TraceClock(), 0, text);
+		}
+#endif
+	}
+	
+	return assertion;
+}
+
+// Finds the line and column of the errors kept since this was last done.
+// It's done when they're asked for, or before their source is closed.
+static void LT_PlaceErrors(LT_Context *ctx)
+{
+	unsigned i = ctx->errorsPlaced;
+	
+	if(i < ctx->errorBase)
+	{
+		i = ctx->errorBase;
+	}
+	
+	if(ctx->assertCount - i > LT_ERROR_RING)
+	{
+		i = ctx->assertCount - LT_ERROR_RING;
+	}
+	
+	for(; i != ctx->assertCount; i++)
+	{
+		LT_ErrorInfo *err = &ctx->errorRing[i % LT_ERROR_RING];
+		
+		if(!LT_OffsetToLineColCtx(ctx, err->offset, &err->line, &err->col))
+		{
+			err->line = err->col = 0;
+		}
+	}
+	
+	ctx->errorsPlaced = ctx->assertCount;
+}
+
+// Records an error where the source is up to.
+static LT_BOOL LT_Raise(LT_Context *ctx, LT_BOOL assertion, const char *func, int code, long arg, const char *detail)
+{
+	if(!assertion)
+	{
+		return LT_FALSE;
+	}
+	
+	return LT_RaiseAt(ctx, LT_TRUE, LT_Tell(ctx), func, code, arg, detail);
+}
+
+static void LT_AssertV(LT_Context *ctx, const char *fmt, va_list va)
+{
+	vsnprintf(ctx->assertText, sizeof(ctx->assertText), fmt, va);
+	LT_Raise(ctx, LT_TRUE, NULL, LT_ERR_ASSERT, 0, ctx->assertText);
+}
+
+LT_BOOL LT_AssertCtx(LT_Context *ctx, LT_BOOL assertion, const char *fmt, ...)
+{
+	if(assertion)
+	{
+		va_list va;
+		
+		va_start(va, fmt);
+		LT_AssertV(ctx, fmt, va);
+		va_end(va);
+	}
+	
+	return assertion;
+}
+
+LT_BOOL LT_Assert(LT_BOOL assertion, const char *fmt, ...)
+{
+	if(assertion)
+	{
+		va_list va;
+		
+		va_start(va, fmt);
+		LT_AssertV(LT_Default(), fmt, va);
+		va_end(va);
+	}
+	
+	return assertion;
+}
+
+void LT_Error(int type)
+{
+	fprintf(stderr, "%s", errors[type]);
+	exit(1);
+}
+
+// Writes an error's message into buf the way snprintf would, and returns
+// how long the whole of it is.
+size_t LT_FormatError(const LT_ErrorInfo *err, char *buf, size_t size)
+{
+	char what[LT_ERROR_TEXT];
+	int n;
+	
+	switch(err->code)
+	{
+	case LT_ERR_ASSERT:
+		snprintf(what, sizeof(what), "%s", err->detail != NULL ? err->detail : "");
+		break;
+	
+	case LT_ERR_SYSTEM:
+		snprintf(what, sizeof(what), "%s", strerror((int)err->arg));
+		break;
+	
+	case LT_ERR_ICONV:
+		if(err->detail != NULL)
+		{
+			snprintf(what, sizeof(what), "%s for %s", ltErrorText[err->code], err->detail);
+			break;
+		}
+		
+		snprintf(what, sizeof(what), "%s", ltErrorText[err->code]);
+		break;
+	
+	case LT_ERR_POSITION:
+		snprintf(what, sizeof(what), "Position %ld out of range", err->arg);
+		break;
+	
+	case LT_ERR_ESCAPE:
+		snprintf(what, sizeof(what), "Unknown escape character '%c'", (int)err->arg);
+		break;
+	
+	case LT_ERR_MEMORY:
+		snprintf(what, sizeof(what), "Out of memory asking for %ld bytes", err->arg);
+		break;
+	
+	default:
+		snprintf(what, sizeof(what), "%s", err->code > 0 && err->code < LT_ERR_MAX ? ltErrorText[err->code] : "Unknown error");
+		break;
+	}
+	
+	if(err->line > 0)
+	{
+		n = snprintf(buf, size, "(line %d, col %d, offset %ld) %s%s%s", err->line, err->col, err->offset,
+			err->func != NULL ? err->func : "", err->func != NULL ? ": " : "", what);
+	}
+	else
+	{
+		n = snprintf(buf, size, "(offset %ld) %s%s%s", err->offset,
+			err->func != NULL ? err->func : "", err->func != NULL ? ": " : "", what);
+	}
+	
+	return n > 0 ? (size_t)n : 0;
+}
+
+LT_AssertInfo LT_CheckAssertCtx(LT_Context *ctx)
+{
+	LT_AssertInfo ltAssertion;
+	ltAssertion.failure = ctx->assertError;
+	ltAssertion.str = NULL;
+	
+	if(ctx->assertError)
+	{
+		LT_PlaceErrors(ctx);
+		LT_FormatError(&ctx->errorRing[(ctx->assertCount - 1) % LT_ERROR_RING], ctx->errorText, sizeof(ctx->errorText));
+		ltAssertion.str = ctx->errorText;
+	}
+	
+	return ltAssertion;
+}
+
+LT_AssertInfo LT_CheckAssert()
+{
+	return LT_CheckAssertCtx(LT_Default());
+}
+
+// Copies up to max of the errors kept since they were last cleared into
+// out, oldest first, and returns how many there were. If there are more,
+// the newest are given.
+size_t LT_GetErrorsCtx(LT_Context *ctx, LT_ErrorInfo *out, size_t max)
+{
+	size_t kept = ctx->assertCount - ctx->errorBase, i;
+	
+	LT_PlaceErrors(ctx);
+	
+	if(kept > LT_ERROR_RING)
+	{
+		kept = LT_ERROR_RING;
+	}
+	
+	if(kept > max)
+	{
+		kept = max;
+	}
+	
+	for(i = 0; i < kept; i++)
+	{
+		out[i] = ctx->errorRing[(ctx->assertCount - kept + i) % LT_ERROR_RING];
+	}
+	
+	return kept;
+}
+
+size_t LT_GetErrors(LT_ErrorInfo *out, size_t max)
+{
+	return LT_GetErrorsCtx(LT_Default(), out, max);
+}
+
+void LT_ClearErrorsCtx(LT_Context *ctx)
+{
+	ctx->assertError = LT_FALSE;
+	ctx->errorBase = ctx->assertCount;
+}
+
+void LT_ClearErrors(void)
+{
+	LT_ClearErrorsCtx(LT_Default());
+}
+
+#ifndef __GDCC__
+static LT_BOOL LT_OpenPath(LT_Context *ctx, const char *filePath)
+#else
+static LT_BOOL LT_OpenPath(LT_Context *ctx, __str filePath)
+#endif
+{
+	LT_CloseFileCtx(ctx);
+	
+#ifndef __GDCC__
+	// Files to be converted or stripped are read in whole, since that's how
+	// it's done.
+	if(ctx->cfg.mapFiles || LT_Converting(ctx) || ctx->cfg.stripInvalid)
+	{
+		if(!LT_MapFile(ctx, filePath))
+		{
+			return LT_FALSE;
+		}
+		
+#ifndef LT_NO_ICONV
+		if(ctx->cfg.doConvert)
+		{
+			return LT_ConvertSource(ctx, "LT_OpenFile");
+		}
+#endif
+		
+		if(ctx->cfg.stripInvalid)
+		{
+			return LT_StripSource(ctx, "LT_OpenFile");
+		}
+		
+		return LT_TRUE;
+	}
+#endif
+	
+	ctx->parseFile = fopen(filePath, "r");
+	
+	if(ctx->parseFile == NULL)
+	{
+		LT_Raise(ctx, LT_TRUE, "LT_OpenFile", LT_ERR_SYSTEM, errno, NULL);
+		return LT_FALSE;
+	}
+	
+	return LT_TRUE;
+}
+
+#ifndef __GDCC__
+LT_BOOL LT_OpenFileCtx(LT_Context *ctx, const char *filePath)
+#else
+LT_BOOL LT_OpenFileCtx(LT_Context *ctx, __str filePath)
+#endif
+{
+#ifndef LT_NO_TRACE
+	if(LT_Tracing(ctx))
+	{
+		unsigned long long start = LT_TraceClock();
+		LT_BOOL ok = LT_OpenPath(ctx, filePath);
+		
+		LT_TraceEvent(ctx, "LT_OpenFile", 'X', start, ok ? (size_t)(ctx->buf != NULL ? ctx->bufLen : 0) : 0, filePath);
+		return ok;
+	}
+#endif
+	
+	return LT_OpenPath(ctx, filePath);
+}
+
+#ifndef __GDCC__
+LT_BOOL LT_OpenFile(const char *filePath)
+#else
+LT_BOOL LT_OpenFile(__str filePath)
+#endif
+{
+	return LT_OpenFileCtx(LT_Default(), filePath);
+}
+
+LT_BOOL LT_OpenMemoryCtx(LT_Context *ctx, const char *data, size_t size)
+{
+	LT_CloseFileCtx(ctx);
+	
+	if(LT_Raise(ctx, data == NULL && size != 0, "LT_OpenMemory", LT_ERR_NULL_DATA, 0, NULL))
+	{
+		return LT_FALSE;
+	}
+	
+	ctx->buf = data != NULL ? data : "";
+	ctx->bufLen = size;
+	ctx->bufPos = 0;
+	
+#ifndef LT_NO_ICONV
+	if(ctx->cfg.doConvert)
+	{
+		return LT_ConvertSource(ctx, "LT_OpenMemory");
+	}
+#endif
+	
+	if(ctx->cfg.stripInvalid)
+	{
+		return LT_StripSource(ctx, "LT_OpenMemory");
+	}
+	
+	return LT_TRUE;
+}
+
+LT_BOOL LT_OpenMemory(const char *data, size_t size)
+{
+	return LT_OpenMemoryCtx(LT_Default(), data, size);
+}
+
+// How big a stream's buffer has to get to hold need bytes.
+static size_t LT_FeedCap(LT_Context *ctx, size_t need)
+{
+	size_t newCap = ctx->feedCap ? ctx->feedCap : TOKEN_STR_BLOCK_LENGTH;
+	
+	while(newCap < need)
+	{
+		newCap *= 2;
+	}
+	
+	return newCap;
+}
+
+static void LT_FeedBytes(LT_Context *ctx, const char *data, size_t len, LT_BOOL isLast)
+{
+	size_t keep;
+	
+	// Only what hasn't been lexed yet is kept, so the buffer never needs to
+	// be bigger than one piece of data plus an unfinished token. Its lines
+	// are indexed before the rest goes.
+	if(ctx->buf != NULL)
+	{
+		LT_IndexLines(ctx, ctx->streamBase + ctx->bufPos);
+	}
+	
+	keep = ctx->bufLen - ctx->bufPos;
+	
+	if(ctx->bufOwned == NULL || keep + len > ctx->feedCap)
+	{
+		size_t newCap = LT_FeedCap(ctx, keep + len);
+		char *newBuf = LT_Alloc(ctx, newCap);
+		
+		if(keep != 0)
+		{
+			memcpy(newBuf, ctx->buf + ctx->bufPos, keep);
+		}
+		
+		LT_Unreserve(ctx, ctx->ownedSize);
+		free(ctx->bufOwned);
+		LT_OwnBuffer(ctx, newBuf, newCap);
+		ctx->feedCap = newCap;
+	}
+	else if(ctx->bufPos != 0)
+	{
+		memmove(ctx->bufOwned, ctx->bufOwned + ctx->bufPos, keep);
+	}
+	
+	if(len != 0)
+	{
+		memcpy(ctx->bufOwned + keep, data, len);
+	}
+	
+	ctx->streamBase += ctx->bufPos;
+	ctx->buf = ctx->bufOwned;
+	ctx->bufLen = keep + len;
+	ctx->bufPos = 0;
+	ctx->streamEnd = isLast;
+	ctx->starved = LT_FALSE;
+}
+
+#ifndef LT_NO_ICONV
+// Converts data before adding it to the stream, along with anything that
+// was held back last time.
+static LT_BOOL LT_FeedConverted(LT_Context *ctx, const char *data, size_t len, LT_BOOL isLast)
+{
+	const char *in = data;
+	char *joined = NULL, *str;
+	size_t inLen = len, strLen, used, pending = ctx->pendingLen;
+	LT_BOOL detect = ctx->icDetect;
+	
+	if(ctx->pendingLen != 0)
+	{
+		joined = LT_Alloc(ctx, ctx->pendingLen + len);
+		memcpy(joined, ctx->pending, ctx->pendingLen);
+		
+		if(len != 0)
+		{
+			memcpy(joined + ctx->pendingLen, data, len);
+		}
+		
+		in = joined;
+		inLen += ctx->pendingLen;
+		ctx->pendingLen = 0;
+	}
+	
+	if(ctx->icDetect)
+	{
+		const char *code = NULL;
+		size_t bom;
+		
+		// Not enough to tell if there's a BOM yet.
+		if(inLen < 3 && !isLast)
+		{
+			memcpy(ctx->pending, in, inLen);
+			ctx->pendingLen = inLen;
+			free(joined);
+			LT_FeedBytes(ctx, NULL, 0, LT_FALSE);
+			return LT_TRUE;
+		}
+		
+		bom = LT_DetectBOM(in, inLen, &code);
+		ctx->icDetect = LT_FALSE;
+		
+		if(!LT_OpenConverter(ctx, code))
+		{
+			LT_Raise(ctx, LT_TRUE, "LT_Feed", LT_ERR_ICONV, 0, code);
+			free(joined);
+			return LT_FALSE;
+		}
+		
+		in += bom;
+		inLen -= bom;
+	}
+	
+	if(!ctx->icOpen)
+	{
+		LT_FeedBytes(ctx, in, inLen, isLast);
+		free(joined);
+		return LT_TRUE;
+	}
+	
+	str = LT_ConvertInput(ctx, "LT_Feed", in, inLen, !isLast, &strLen, &used);
+	
+	// Refused data leaves the stream as it was, so it can be fed again.
+	if(str == NULL)
+	{
+		ctx->pendingLen = pending;
+		ctx->icDetect = detect;
+		free(joined);
+		return LT_FALSE;
+	}
+	
+	memcpy(ctx->pending, in + used, inLen - used);
+	ctx->pendingLen = inLen - used;
+	
+	LT_FeedBytes(ctx, str, strLen, isLast);
+	free(str);
+	free(joined);
+	
+	return LT_TRUE;
+}
+#endif
+
+// Strips data in the stream's buffer after adding it, along with anything
+// that was held back last time.
+static void LT_FeedStripped(LT_Context *ctx, const char *data, size_t len, LT_BOOL isLast)
+{
+	size_t total = len, start, n;
+	
+	if(ctx->pendingLen != 0)
+	{
+		LT_FeedBytes(ctx, ctx->pending, ctx->pendingLen, LT_FALSE);
+		total += ctx->pendingLen;
+		ctx->pendingLen = 0;
+	}
+	
+	LT_FeedBytes(ctx, data, len, isLast);
+	
+	start = ctx->bufLen - total;
+	n = LT_StripInvalid(ctx, ctx->bufOwned + start, total, !isLast);
+	
+	ctx->pendingLen = total - n;
+	memcpy(ctx->pending, ctx->bufOwned + start + n, total - n);
+	ctx->bufLen -= total - n;
+}
+
+// Adds data to the end of a stream, starting a new one if there isn't one
+// open. Tokens are read with LT_GetToken as usual. When the data runs out
+// partway through a token, it returns TOK_EOF and LT_NeedsInput is true
+// until more is fed. isLast marks the end of the stream.
+LT_BOOL LT_FeedCtx(LT_Context *ctx, const char *data, size_t len, LT_BOOL isLast)
+{
+	size_t need;
+	
+	if(!ctx->streaming || ctx->streamEnd)
+	{
+		LT_CloseFileCtx(ctx);
+		ctx->streaming = LT_TRUE;
+		
+#ifndef LT_NO_ICONV
+		ctx->icDetect = ctx->cfg.doConvert;
+#endif
+	}
+	
+	if(LT_Raise(ctx, data == NULL && len != 0, "LT_Feed", LT_ERR_NULL_DATA, 0, NULL))
+	{
+		return LT_FALSE;
+	}
+	
+	// The data is refused if the buffer can't grow to take it. Converting
+	// it can make it bigger than this.
+	need = ctx->bufLen - ctx->bufPos + ctx->pendingLen + len;
+	
+	if(need > ctx->feedCap && LT_Raise(ctx, !LT_Budget(ctx, LT_FeedCap(ctx, need) - ctx->feedCap), "LT_Feed", LT_ERR_MEMORY, (long)need, NULL))
+	{
+		return LT_FALSE;
+	}
+	
+#ifndef LT_NO_ICONV
+	if(ctx->cfg.doConvert)
+	{
+		return LT_FeedConverted(ctx, data, len, isLast);
+	}
+#endif
+	
+	if(ctx->cfg.stripInvalid)
+	{
+		LT_FeedStripped(ctx, data, len, isLast);
+		return LT_TRUE;
+	}
+	
+	LT_FeedBytes(ctx, data, len, isLast);
+	return LT_TRUE;
+}
+
+LT_BOOL LT_Feed(const char *data, size_t len, LT_BOOL isLast)
+{
+	return LT_FeedCtx(LT_Default(), data, len, isLast);
+}
+
+LT_BOOL LT_NeedsInputCtx(LT_Context *ctx)
+{
+	return ctx->streaming && ctx->starved;
+}
+
+LT_BOOL LT_NeedsInput()
+{
+	return LT_NeedsInputCtx(LT_Default());
+}
+
+void LT_SetPosCtx(LT_Context *ctx, int newPos)
+{
+	if(LT_Raise(ctx, ctx->streaming, "LT_SetPos", LT_ERR_STREAM_SEEK, 0, NULL))
+	{
+		return;
+	}
+	
+	if(ctx->buf != NULL)
+	{
+		if(!LT_Raise(ctx, newPos < 0 || (size_t)newPos > ctx->bufLen, "LT_SetPos", LT_ERR_POSITION, newPos, NULL))
+		{
+			ctx->bufPos = (size_t)newPos;
+		}
+		
+		return;
+	}
+	
+	// Lines are noted as they're read, so any that would be skipped over
+	// are read first.
+	LT_IndexLines(ctx, 0);
+	
+	if(newPos > 0 && (size_t)newPos > ctx->lineScanned && fseek(ctx->parseFile, (long)ctx->lineScanned, SEEK_SET) == 0)
+	{
+		size_t left = (size_t)newPos - ctx->lineScanned;
+		
+		while(left != 0 && LT_ReadC(ctx) != EOF)
+		{
+			left--;
+		}
+	}
+	
+#ifndef __GDCC__
+	if(fseek(ctx->parseFile, newPos, SEEK_SET) != 0)
+	{
+		LT_Raise(ctx, ferror(ctx->parseFile), "LT_SetPos", LT_ERR_SYSTEM, errno, NULL);
+	}
+#else
+	fseek(ctx->parseFile, newPos, SEEK_SET);
+#endif
+}
+
+void LT_SetPos(int newPos)
+{
+	LT_SetPosCtx(LT_Default(), newPos);
+}
+
+// Gives the line and column (both from 1, columns in bytes) of an offset
+// in the source, or returns false if it's past what's been read or fed.
+LT_BOOL LT_OffsetToLineColCtx(LT_Context *ctx, long offset, int *line, int *col)
+{
+	size_t at;
+	
+	if(offset < 0 || (ctx->buf == NULL && ctx->parseFile == NULL))
+	{
+		return LT_FALSE;
+	}
+	
+	LT_IndexLines(ctx, (size_t)offset);
+	
+	if((size_t)offset > ctx->lineScanned)
+	{
+		return LT_FALSE;
+	}
+	
+	at = LT_LineOf(ctx, (size_t)offset);
+	*line = (int)at + 1;
+	*col = (int)((size_t)offset - ctx->lineStarts[at]) + 1;
+	
+	return LT_TRUE;
+}
+
+LT_BOOL LT_OffsetToLineCol(long offset, int *line, int *col)
+{
+	return LT_OffsetToLineColCtx(LT_Default(), offset, line, col);
+}
+
+void LT_CloseFileCtx(LT_Context *ctx)
+{
+	// Errors are placed in the source they came from while it's still open.
+	LT_PlaceErrors(ctx);
+	
+	if(ctx->parseFile != NULL)
+	{
+		fclose(ctx->parseFile);
+		ctx->parseFile = NULL;
+	}
+	
+#ifndef LT_NO_MMAP
+	if(ctx->mapBase != NULL)
+	{
+		LT_Unmap(ctx->mapBase, ctx->mapLen);
+		ctx->mapBase = NULL;
+	}
+#endif
+	
+	if(ctx->bufOwned != NULL)
+	{
+		LT_Unreserve(ctx, ctx->ownedSize);
+		free(ctx->bufOwned);
+		ctx->bufOwned = NULL;
+		ctx->ownedSize = 0;
+	}
+	
+	ctx->buf = NULL;
+	ctx->bufLen = ctx->bufPos = 0;
+	
+	ctx->streaming = ctx->streamEnd = ctx->starved = LT_FALSE;
+	ctx->streamBase = ctx->feedCap = 0;
+	
+	ctx->pendingLen = 0;
+	
+	// The index's memory is kept for the next source.
+	ctx->lineCount = ctx->lineHint = ctx->lineScanned = 0;
+	
+#ifndef LT_NO_ICONV
+	ctx->icDetect = LT_FALSE;
+#endif
+}
+
+void LT_CloseFile()
+{
+	LT_CloseFileCtx(&defaultCtx);
+}
+
+// With parseNumbers, a sign right after an exponent's e (or p in hex) is
+// part of the number, like in C's preprocessing numbers.
+static inline LT_BOOL LT_ExponentSign(LT_Context *ctx, LT_BOOL hex, int prev, int c)
+{
+	return ctx->cfg.parseNumbers && (c == '+' || c == '-') && (prev | 0x20) == (hex ? 'p' : 'e');
+}
+
+static const char *LT_ScanNumber(LT_Context *ctx, const char *p, const char *end)
+{
+	const char *start = p;
+	LT_BOOL hex = end - p >= 2 && p[0] == '0' && (p[1] | 0x20) == 'x';
+	
+	while(LT_TRUE)
+	{
+		p = ctx->scan[LT_SCAN_NUMBER](p, end);
+		
+		if(p == end || p == start || !LT_ExponentSign(ctx, hex, p[-1], *p))
+		{
+			return p;
+		}
+		
+		p++;
+	}
+}
+
+char *LT_ReadNumberCtx(LT_Context *ctx)
+{
+	size_t i = 0, n = 0, cap = TOKEN_STR_BLOCK_LENGTH;
+	char *str;
+	int c = '\0', prev = '\0';
+	LT_BOOL hex = LT_FALSE;
+	
+	if(ctx->buf != NULL)
+	{
+		const char *start = ctx->buf + ctx->bufPos;
+		
+		i = LT_ScanNumber(ctx, start, ctx->buf + ctx->bufLen) - start;
+		str = LT_ArenaAlloc(ctx, i + 1);
+		memcpy(str, start, i);
+		ctx->bufPos += i;
+		
+		return LT_StrFinish(ctx, str, i + 1, i);
+	}
+	
+	str = LT_ArenaAlloc(ctx, cap);
+	
+	while(c != EOF)
+	{
+		c = LT_ReadC(ctx);
+		
+		if(c == EOF || !((ctx->charFlags[c] & LT_CF_NUMBER) || LT_ExponentSign(ctx, hex, prev, c)))
+		{
+			LT_UnreadC(ctx, c);
+			break;
+		}
+		
+		hex = hex || (n == 1 && prev == '0' && (c | 0x20) == 'x');
+		prev = c;
+		n++;
+		
+		str = LT_StrReserve(ctx, str, &cap, i + 1);
+		
+		str[i++] = c;
+	}
+	
+	return LT_StrFinish(ctx, str, cap, i);
+}
+
+char *LT_ReadNumber()
+{
+	return LT_ReadNumberCtx(LT_Default());
+}
+
+// Leaves a string as a span of the buffer if its bytes don't need changing,
+// or with lazyEscapes, if only its escapes do.
+static LT_BOOL LT_SpanString(LT_Context *ctx, LT_Token *tk, char term)
+{
+	const char *start = ctx->buf + ctx->bufPos, *p = start, *end = ctx->buf + ctx->bufLen;
+	LT_BOOL escapes = LT_FALSE;
+	
+	while(p < end && *p != term)
+	{
+		if(*p == '\n')
+		{
+			return LT_FALSE;
+		}
+		
+		if(*p == '\\' && ctx->cfg.escapeChars)
+		{
+			if(!ctx->cfg.lazyEscapes || p + 1 == end || p[1] == '\n')
+			{
+				return LT_FALSE;
+			}
+			
+			escapes = LT_TRUE;
+			p++;
+		}
+		
+		p++;
+	}
+	
+	if(p == end)
+	{
+		return LT_FALSE;
+	}
+	
+	tk->string = NULL;
+	tk->spanLen = tk->strlen = (unsigned)(p - start);
+	tk->hasEscapes = escapes;
+	ctx->bufPos = (p - ctx->buf) + 1;
+	
+	return LT_TRUE;
+}
+
+// Decodes the escapes in len bytes of src into dst, which has room for at
+// least as many, returning how many bytes it wrote. src is at pos in the
+// source, for errors.
+static size_t LT_DecodeEscapes(LT_Context *ctx, char *dst, const char *src, size_t len, long pos)
+{
+	const char *start = src, *end = src + len;
+	char *out = dst;
+	
+	while(src < end)
+	{
+		const char *esc = memchr(src, '\\', end - src);
+		unsigned char c;
+		unsigned i, n;
+		
+		if(esc == NULL || esc + 1 == end)
+		{
+			esc = end;
+		}
+		
+		memcpy(out, src, esc - src);
+		out += esc - src;
+		
+		if(esc == end)
+		{
+			break;
+		}
+		
+		c = esc[1];
+		src = esc + 2;
+		
+		switch(ltEscapes[c])
+		{
+		case LT_ESC_HEX:
+			for(i = 0; src < end && ltHexDigits[(unsigned char)*src]; src++)
+			{
+				i = i * 16 + ltHexDigits[(unsigned char)*src] - 1;
+			}
+			
+			*out++ = (char)i;
+			break;
+		
+		case LT_ESC_OCT:
+			for(i = c - '0', n = 1; n < 3 && src < end && *src >= '0' && *src <= '7'; n++, src++)
+			{
+				i = i * 8 + (*src - '0');
+			}
+			
+			*out++ = (char)i;
+			break;
+		
+		case 0:
+			LT_RaiseAt(ctx, LT_TRUE, pos + (long)(esc - start), "LT_Escaper", LT_ERR_ESCAPE, (unsigned char)c, NULL);
+			*out++ = c;
+			break;
+		
+		default:
+			*out++ = (char)ltEscapes[c];
+			break;
+		}
+	}
+	
+	return out - dst;
+}
+
+static void LT_LexString(LT_Context *ctx, LT_Token *tk, char term)
+{
+	size_t i = 0, cap = TOKEN_STR_BLOCK_LENGTH;
+	char *str;
+	int c;
+	
+	tk->spanPos = (int)LT_Tell(ctx);
+	
+	if((LT_UseSpans(ctx) || (ctx->cfg.lazyEscapes && ctx->buf != NULL && !ctx->streaming)) &&
+		LT_SpanString(ctx, tk, term))
+	{
+		return;
+	}
+	
+	str = LT_ArenaAlloc(ctx, cap);
+	
+	while(LT_TRUE)
+	{
+		if(ctx->buf != NULL)
+		{
+			// Copy runs of plain characters straight out of the buffer.
+			const char *p = ctx->buf + ctx->bufPos, *end = ctx->buf + ctx->bufLen, *run = p;
+			size_t n;
+			
+			while(p < end && *p != term && *p != '\\' && *p != '\n')
+			{
+				p++;
+			}
+			
+			n = p - run;
+			str = LT_StrReserve(ctx, str, &cap, i + n);
+			
+			memcpy(str + i, run, n);
+			i += n;
+			ctx->bufPos += n;
+		}
+		
+		c = LT_ReadC(ctx);
+		
+		if(c == term)
+		{
+			break;
+		}
+		
+		if(LT_Raise(ctx, c == EOF || c == '\n', "LT_ReadString", LT_ERR_UNTERMINATED, 0, NULL))
+		{
+			str[0] = '\0';
+			
+			tk->string = LT_ArenaReAlloc(ctx, str, cap, 1);
+			tk->strlen = 0;
+			tk->spanLen = (unsigned)(LT_Tell(ctx) - tk->spanPos - (c != EOF));
+			
+			return;
+		}
+		
+		if(c == '\\' && ctx->cfg.escapeChars)
+		{
+			c = LT_ReadC(ctx);
+			
+			if(LT_Raise(ctx, c == EOF || c == '\n', "LT_ReadString", LT_ERR_UNTERMINATED, 0, NULL))
+			{
+				str[i] = '\0';
+				tk->strlen = (unsigned)i;
+				tk->spanLen = (unsigned)(LT_Tell(ctx) - tk->spanPos - (c != EOF));
+				tk->string = LT_ArenaReAlloc(ctx, str, cap, i + 1);
+				return;
+			}
+			
+			str = LT_StrReserve(ctx, str, &cap, i + 1);
+			
+			str = LT_EscaperCtx(ctx, str, i++, c);
+			tk->hasEscapes = LT_TRUE;
+		}
+		else
+		{
+			// Buffers are stripped when they're opened, so this is only for
+			// files read with stdio under GDCC.
+			if(ctx->cfg.stripInvalid && ctx->buf == NULL && !(ctx->charFlags[c] & LT_CF_PRINT))
+			{
+				c = ' ';
+			}
+			
+			str = LT_StrReserve(ctx, str, &cap, i + 1);
+			
+			str[i++] = c;
+		}
+	}
+	
+	tk->string = LT_StrFinish(ctx, str, cap, i);
+	tk->strlen = (unsigned)i;
+	tk->spanLen = (unsigned)(LT_Tell(ctx) - tk->spanPos - 1);
+	
+	return;
+}
+
+void LT_ReadStringCtx(LT_Context *ctx, LT_Token *tk, char term)
+{
+#ifndef LT_NO_TRACE
+	if(LT_Tracing(ctx))
+	{
+		unsigned long long start = LT_TraceClock();
+		
+		LT_LexString(ctx, tk, term);
+		
+		if(tk->spanLen >= LT_TRACE_LONG_STRING)
+		{
+			LT_TraceEvent(ctx, "LT_ReadString", 'X', start, tk->spanLen, NULL);
+		}
+		
+		return;
+	}
+#endif
+	
+	LT_LexString(ctx, tk, term);
+}
+
+void LT_ReadString(LT_Token *tk, char term)
+{
+	LT_ReadStringCtx(LT_Default(), tk, term);
+}
+
+char *LT_EscaperCtx(LT_Context *ctx, char *str, size_t pos, char escape)
+{
+	unsigned i, n;
+	long offset;
+	int c;
+	
+	switch(ltEscapes[(unsigned char)escape])
+	{
+		case LT_ESC_HEX:
+			for(i = 0; (c = LT_ReadC(ctx)) != EOF && ltHexDigits[c]; )
+			{
+				i = i * 16 + ltHexDigits[c] - 1;
+			}
+			
+			LT_UnreadC(ctx, c);
+			str[pos] = i;
+			break;
+		
+		case LT_ESC_OCT:
+			// Up to three digits, like in C.
+			for(i = escape - '0', n = 1; n < 3; n++)
+			{
+				c = LT_ReadC(ctx);
+				
+				if(c < '0' || c > '7')
+				{
+					LT_UnreadC(ctx, c);
+					break;
+				}
+				
+				i = i * 8 + (c - '0');
+			}
+			
+			str[pos] = i;
+			break;
+		
+		case 0:
+			// The backslash and escape were just read, and the error points
+			// at the backslash like it does when a span is decoded.
+			offset = LT_Tell(ctx);
+			LT_RaiseAt(ctx, LT_TRUE, offset < 0 ? offset : offset - 2, "LT_Escaper", LT_ERR_ESCAPE, (unsigned char)escape,
+				NULL);
+			str[pos] = escape;
+			break;
+		
+		default:
+			str[pos] = (char)ltEscapes[(unsigned char)escape];
+			break;
+	}
+	
+	return str;
+}
+
+char *LT_Escaper(char *str, size_t pos, char escape)
+{
+	return LT_EscaperCtx(LT_Default(), str, pos, escape);
+}
+
+/*
+ * Interning
+ */
+
+// FNV-1a, starting from hash.
+static unsigned LT_HashSeeded(unsigned hash, const char *str, size_t len)
+{
+	size_t i;
+	
+	for(i = 0; i < len; i++)
+	{
+		hash ^= (unsigned char)str[i];
+		hash *= 16777619u;
+	}
+	
+	return hash;
+}
+
+static unsigned LT_HashString(const char *str, size_t len)
+{
+	return LT_HashSeeded(2166136261u, str, len);
+}
+
+static void LT_GrowSymSlots(LT_Context *ctx)
+{
+	size_t count = ctx->symSlotCount ? ctx->symSlotCount * 2 : 256, i;
+	unsigned *slots;
+	
+	LT_Reserve(ctx, count * sizeof(unsigned));
+	slots = LT_Alloc(ctx, count * sizeof(unsigned));
+	ctx->memUsed += count * sizeof(unsigned);
+	
+	memset(slots, 0, count * sizeof(unsigned));
+	
+	for(i = 0; i < ctx->symCount; i++)
+	{
+		size_t at = ctx->symbols[i].hash & (count - 1);
+		
+		while(slots[at] != 0)
+		{
+			at = (at + 1) & (count - 1);
+		}
+		
+		slots[at] = (unsigned)i + 1;
+	}
+	
+	LT_Unreserve(ctx, ctx->symSlotCount * sizeof(unsigned));
+	free(ctx->symSlots);
+	ctx->symSlots = slots;
+	ctx->symSlotCount = count;
+}
+
+// Returns the symbol ID of a string, adding it if it's new.
+static int LT_InternString(LT_Context *ctx, const char *str, size_t len)
+{
+	unsigned hash = LT_HashString(str, len);
+	LT_Symbol *sym;
+	char *copy;
+	size_t at;
+	
+	// Keep the table at most half full so probe runs stay short.
+	if((ctx->symCount + 1) * 2 > ctx->symSlotCount)
+	{
+		LT_GrowSymSlots(ctx);
+	}
+	
+	for(at = hash & (ctx->symSlotCount - 1); ctx->symSlots[at] != 0; at = (at + 1) & (ctx->symSlotCount - 1))
+	{
+		sym = &ctx->symbols[ctx->symSlots[at] - 1];
+		
+		if(sym->hash == hash && sym->len == len && memcmp(sym->str, str, len) == 0)
+		{
+			return (int)ctx->symSlots[at];
+		}
+	}
+	
+	if(ctx->symCount == ctx->symCap)
+	{
+		size_t newCap = ctx->symCap ? ctx->symCap * 2 : 128;
+		
+		LT_Reserve(ctx, (newCap - ctx->symCap) * sizeof(LT_Symbol));
+		ctx->symbols = LT_ReAlloc(ctx, ctx->symbols, newCap * sizeof(LT_Symbol));
+		ctx->memUsed += (newCap - ctx->symCap) * sizeof(LT_Symbol);
+		ctx->symCap = newCap;
+	}
+	
+	copy = LT_ChunkAlloc(ctx, &ctx->symArena, len + 1);
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+	
+	sym = &ctx->symbols[ctx->symCount++];
+	sym->str = copy;
+	sym->len = (unsigned)len;
+	sym->hash = hash;
+	
+	ctx->symSlots[at] = (unsigned)ctx->symCount;
+	
+	return (int)ctx->symCount;
+}
+
+// Swaps an identifier's text for its interned string.
+static void LT_InternToken(LT_Context *ctx, LT_Token *tk)
+{
+	const char *str = tk->string != NULL ? tk->string : ctx->buf + tk->spanPos;
+	size_t len = tk->string != NULL ? tk->strlen : tk->spanLen;
+	
+	tk->symbol = LT_InternString(ctx, str, len);
+	
+	if(tk->string != NULL)
+	{
+		LT_ArenaReAlloc(ctx, tk->string, len + 1, 0);
+	}
+	
+	tk->string = (char *)ctx->symbols[tk->symbol - 1].str;
+	tk->strlen = (unsigned)len;
+}
+
+int LT_InternCtx(LT_Context *ctx, const char *str)
+{
+	return LT_InternString(ctx, str, strlen(str));
+}
+
+int LT_Intern(const char *str)
+{
+	return LT_InternCtx(LT_Default(), str);
+}
+
+// Returns the string of a symbol, or NULL if there's no such symbol.
+const char *LT_SymbolNameCtx(LT_Context *ctx, int symbol)
+{
+	if(symbol <= 0 || (size_t)symbol > ctx->symCount)
+	{
+		return NULL;
+	}
+	
+	return ctx->symbols[symbol - 1].str;
+}
+
+const char *LT_SymbolName(int symbol)
+{
+	return LT_SymbolNameCtx(LT_Default(), symbol);
+}
+
+/*
+ * Comments
+ */
+
+// Finds the end of a comment in [p, end), where p is just past its opener,
+// or returns NULL if it isn't closed first. A line comment ends before its
+// '\n'. Each kind only looks for one character with memchr, so a comment
+// costs about as much as finding it.
+static const char *LT_CommentEnd(int kind, const char *p, const char *end)
+{
+	const char *q;
+	unsigned depth = 1;
+	
+	switch(kind)
+	{
+	case TOK_Comment:
+		return memchr(p, '\n', end - p);
+	
+	case TOK_BlkCmtO:
+		while((q = memchr(p, '/', end - p)) != NULL)
+		{
+			if(q > p && q[-1] == '*')
+			{
+				return q + 1;
+			}
+			
+			p = q + 1;
+		}
+		
+		return NULL;
+	}
+	
+	// Nested comments count their "/+" and "+/". A '/' that's already
+	// part of one (p is past it) can't start another.
+	while((q = memchr(p, '+', end - p)) != NULL)
+	{
+		if(q > p && q[-1] == '/')
+		{
+			depth++;
+			p = q + 1;
+		}
+		else if(q + 1 < end && q[1] == '/')
+		{
+			if(--depth == 0)
+			{
+				return q + 2;
+			}
+			
+			p = q + 2;
+		}
+		else
+		{
+			p = q + 1;
+		}
+	}
+	
+	return NULL;
+}
+
+// LT_CommentEnd for stdio, a character at a time.
+static LT_BOOL LT_SkipCommentC(LT_Context *ctx, int kind)
+{
+	unsigned depth = 1;
+	int c, prev = 0;
+	
+	while((c = LT_ReadC(ctx)) != EOF)
+	{
+		if(kind == TOK_Comment)
+		{
+			if(c == '\n')
+			{
+				LT_UnreadC(ctx, c);
+				return LT_TRUE;
+			}
+		}
+		else if(kind == TOK_BlkCmtO)
+		{
+			if(prev == '*' && c == '/')
+			{
+				return LT_TRUE;
+			}
+		}
+		else if(prev == '/' && c == '+')
+		{
+			depth++;
+			c = 0;
+		}
+		else if(prev == '+' && c == '/')
+		{
+			if(--depth == 0)
+			{
+				return LT_TRUE;
+			}
+			
+			c = 0;
+		}
+		
+		prev = c;
+	}
+	
+	return kind == TOK_Comment;
+}
+
+// With skipComments, reads a whole comment once its '/' has been read, and
+// with commentSpans makes tk a TOK_Comment spanning it. Returns LT_FALSE, having read nothing
+// more, if the '/' doesn't start one.
+static LT_BOOL LT_LexComment(LT_Context *ctx, LT_Token *tk)
+{
+	int next = LT_ReadC(ctx), kind;
+	LT_BOOL closed;
+	
+	switch(next)
+	{
+	case '/': kind = TOK_Comment; break;
+	case '*': kind = TOK_BlkCmtO; break;
+	case '+': kind = TOK_NstCmtO; break;
+	default:
+		LT_UnreadC(ctx, next);
+		return LT_FALSE;
+	}
+	
+	if(ctx->buf != NULL)
+	{
+		const char *end = LT_CommentEnd(kind, ctx->buf + ctx->bufPos, ctx->buf + ctx->bufLen);
+		
+		// A line comment can end the source, but in a stream more of it
+		// might be on the way.
+		if(end == NULL)
+		{
+			ctx->bufPos = ctx->bufLen;
+			ctx->hitEnd = LT_TRUE;
+			closed = kind == TOK_Comment;
+		}
+		else
+		{
+			ctx->bufPos = end - ctx->buf;
+			closed = LT_TRUE;
+		}
+	}
+	else
+	{
+		closed = LT_SkipCommentC(ctx, kind);
+	}
+	
+	LT_Raise(ctx, !closed, "LT_GetToken", LT_ERR_COMMENT, 0, NULL);
+	
+	if(ctx->cfg.commentSpans)
+	{
+		tk->kind = TOK_Comment;
+		tk->spanPos = tk->pos;
+		tk->spanLen = tk->strlen = (unsigned)(LT_Tell(ctx) - tk->pos);
+		
+		// A stream's buffer won't keep the comment, so its text is copied.
+		if(ctx->streaming)
+		{
+			tk->string = LT_ArenaStrDup(ctx, ctx->buf + tk->pos, tk->spanLen);
+		}
+	}
+	
+	return LT_TRUE;
+}
+
+/*
+ * Keywords
+ */
+
+// Spreads a hash's bits out, so each displacement sends a hash somewhere
+// unrelated. This is MurmurHash3's finalizer.
+static inline unsigned LT_MixHash(unsigned hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35u;
+	hash ^= hash >> 16;
+	
+	return hash;
+}
+
+static inline unsigned LT_KeywordSlot(const LT_Context *ctx, unsigned hash)
+{
+	return LT_MixHash(hash ^ ctx->keyDisp[hash & ctx->keyBucketMask]) & ctx->keySlotMask;
+}
+
+static void LT_FreeKeywords(LT_Context *ctx)
+{
+	LT_FreeChunks(ctx, ctx->keyArena);
+	free(ctx->keywords);
+	free(ctx->keyList);
+	free(ctx->keyDisp);
+	free(ctx->keySlots);
+	ctx->keyArena = NULL;
+	ctx->keywords = NULL;
+	ctx->keyList = NULL;
+	ctx->keyDisp = ctx->keySlots = NULL;
+	ctx->keyCount = 0;
+	ctx->keyBucketMask = ctx->keySlotMask = ctx->keySeed = 0;
+}
+
+// Finds a displacement for every bucket that gives each of its keywords a
+// slot of its own, biggest buckets first. Returns LT_FALSE if two keywords
+// can't be told apart by their hashes.
+static LT_BOOL LT_PlaceKeywords(LT_Context *ctx, const unsigned *members, const unsigned *bucketStart, unsigned maxSize)
+{
+	unsigned buckets = ctx->keyBucketMask + 1, size, b, i, j;
+	unsigned *placed = LT_Alloc(ctx, maxSize * sizeof(unsigned));
+	LT_BOOL ok = LT_TRUE;
+	
+	for(size = maxSize; size > 0 && ok; size--)
+	{
+		for(b = 0; b < buckets && ok; b++)
+		{
+			const unsigned *member = members + bucketStart[b];
+			unsigned disp, n = 0;
+			
+			if(bucketStart[b + 1] - bucketStart[b] != size)
+			{
+				continue;
+			}
+			
+			// A keyword listed twice keeps its first index.
+			for(i = 0; i < size; i++)
+			{
+				const LT_Symbol *kw = &ctx->keywords[member[i]];
+				
+				for(j = 0; j < n; j++)
+				{
+					const LT_Symbol *other = &ctx->keywords[placed[j]];
+					
+					if(kw->hash == other->hash)
+					{
+						if(kw->len != other->len || memcmp(kw->str, other->str, kw->len) != 0)
+						{
+							ok = LT_FALSE;
+						}
+						
+						break;
+					}
+				}
+				
+				if(j == n)
+				{
+					placed[n++] = member[i];
+				}
+			}
+			
+			for(disp = 0; ok; disp++)
+			{
+				ctx->keyDisp[b] = disp;
+				
+				for(i = 0; i < n; i++)
+				{
+					unsigned *slot = &ctx->keySlots[LT_KeywordSlot(ctx, ctx->keywords[placed[i]].hash)];
+					
+					if(*slot != 0)
+					{
+						break;
+					}
+					
+					*slot = placed[i] + 1;
+				}
+				
+				if(i == n)
+				{
+					break;
+				}
+				
+				while(i-- > 0)
+				{
+					ctx->keySlots[LT_KeywordSlot(ctx, ctx->keywords[placed[i]].hash)] = 0;
+				}
+				
+				if(disp == 0xFFFF)
+				{
+					ok = LT_FALSE;
+				}
+			}
+		}
+	}
+	
+	free(placed);
+	
+	return ok;
+}
+
+// Hashes the keywords with keySeed and tries to build the table for them.
+static LT_BOOL LT_HashKeywords(LT_Context *ctx)
+{
+	unsigned buckets = ctx->keyBucketMask + 1, count = (unsigned)ctx->keyCount, maxSize = 0, i;
+	unsigned *members = LT_Alloc(ctx, count * sizeof(unsigned));
+	unsigned *bucketStart = LT_Alloc(ctx, (buckets + 1) * sizeof(unsigned));
+	unsigned *bucketFill = LT_Alloc(ctx, buckets * sizeof(unsigned));
+	LT_BOOL ok;
+	
+	memset(ctx->keyDisp, 0, buckets * sizeof(unsigned));
+	memset(ctx->keySlots, 0, (ctx->keySlotMask + 1) * sizeof(unsigned));
+	memset(bucketStart, 0, (buckets + 1) * sizeof(unsigned));
+	
+	// Sort the keywords by bucket.
+	for(i = 0; i < count; i++)
+	{
+		LT_Symbol *kw = &ctx->keywords[i];
+		
+		kw->hash = LT_HashSeeded(ctx->keySeed, kw->str, kw->len);
+		bucketStart[(kw->hash & ctx->keyBucketMask) + 1]++;
+	}
+	
+	for(i = 0; i < buckets; i++)
+	{
+		if(bucketStart[i + 1] > maxSize)
+		{
+			maxSize = bucketStart[i + 1];
+		}
+		
+		bucketStart[i + 1] += bucketStart[i];
+		bucketFill[i] = bucketStart[i];
+	}
+	
+	for(i = 0; i < count; i++)
+	{
+		members[bucketFill[ctx->keywords[i].hash & ctx->keyBucketMask]++] = i;
+	}
+	
+	ok = LT_PlaceKeywords(ctx, members, bucketStart, maxSize);
+	
+	free(members);
+	free(bucketStart);
+	free(bucketFill);
+	
+	return ok;
+}
+
+// Copies the config's keywords and builds their perfect hash table.
+static void LT_BuildKeywords(LT_Context *ctx)
+{
+	const char *const *words = ctx->cfg.keywords;
+	unsigned buckets = 1, slots = 1, i;
+	size_t count = 0;
+	LT_Symbol *keywords;
+	const char **keyList;
+	LT_ArenaChunk *keyArena = NULL;
+	
+	while(words != NULL && words[count] != NULL)
+	{
+		count++;
+	}
+	
+	// The config might point at our current copy, so make the new one first.
+	keywords = LT_Alloc(ctx, (count + 1) * sizeof(LT_Symbol));
+	keyList = LT_Alloc(ctx, (count + 1) * sizeof(const char *));
+	
+	for(i = 0; i < count; i++)
+	{
+		size_t len = strlen(words[i]);
+		char *copy = LT_ChunkAlloc(ctx, &keyArena, len + 1);
+		
+		memcpy(copy, words[i], len + 1);
+		keywords[i].str = keyList[i] = copy;
+		keywords[i].len = (unsigned)len;
+	}
+	
+	keyList[count] = NULL;
+	
+	LT_FreeKeywords(ctx);
+	
+	ctx->keywords = keywords;
+	ctx->keyList = keyList;
+	ctx->keyArena = keyArena;
+	ctx->keyCount = count;
+	ctx->cfg.keywords = keyList;
+	
+	if(count == 0)
+	{
+		return;
+	}
+	
+	// About two keywords per bucket, and slots at most half full.
+	while(buckets * 2 < count)
+	{
+		buckets *= 2;
+	}
+	
+	while(slots < count * 2)
+	{
+		slots *= 2;
+	}
+	
+	ctx->keyBucketMask = buckets - 1;
+	ctx->keySlotMask = slots - 1;
+	ctx->keyDisp = LT_Alloc(ctx, buckets * sizeof(unsigned));
+	ctx->keySlots = LT_Alloc(ctx, slots * sizeof(unsigned));
+	
+	// Two keywords with the same hash can't be told apart, which gets
+	// likely with tens of thousands of them. Another seed fixes that.
+	for(i = 0; i < 8; i++)
+	{
+		ctx->keySeed = 2166136261u + i * 0x9E3779B9u;
+		
+		if(LT_HashKeywords(ctx))
+		{
+			return;
+		}
+	}
+	
+	LT_Raise(ctx, LT_TRUE, "LT_Init", LT_ERR_KEYWORDS, 0, NULL);
+	LT_FreeKeywords(ctx);
+	ctx->cfg.keywords = NULL;
+}
+
+// Returns the index of a keyword, or -1 if str isn't one.
+static int LT_FindKeyword(LT_Context *ctx, const char *str, size_t len)
+{
+	unsigned hash = LT_HashSeeded(ctx->keySeed, str, len);
+	unsigned key = ctx->keySlots[LT_KeywordSlot(ctx, hash)];
+	const LT_Symbol *kw;
+	
+	if(key == 0)
+	{
+		return -1;
+	}
+	
+	kw = &ctx->keywords[key - 1];
+	
+	if(kw->hash != hash || kw->len != len || memcmp(kw->str, str, len) != 0)
+	{
+		return -1;
+	}
+	
+	return (int)key - 1;
+}
+
+// Makes an identifier a keyword token if it's one of the keywords.
+static LT_BOOL LT_KeywordToken(LT_Context *ctx, LT_Token *tk)
+{
+	const char *str = tk->string != NULL ? tk->string : ctx->buf + tk->spanPos;
+	size_t len = tk->string != NULL ? tk->strlen : tk->spanLen;
+	int key = LT_FindKeyword(ctx, str, len);
+	
+	if(key < 0)
+	{
+		return LT_FALSE;
+	}
+	
+	if(tk->string != NULL)
+	{
+		LT_ArenaReAlloc(ctx, tk->string, len + 1, 0);
+	}
+	
+	tk->kind = TOK_Keywrd + key;
+	tk->string = (char *)ctx->keywords[key].str;
+	tk->strlen = (unsigned)len;
+	
+	return LT_TRUE;
+}
+
+static inline const char *LT_KindName(LT_Context *ctx, int kind)
+{
+	return kind >= TOK_Keywrd ? ctx->keywords[kind - TOK_Keywrd].str : LT_TkNames[kind];
+}
+
+static inline unsigned LT_DigitValue(int c)
+{
+	if(c >= '0' && c <= '9')
+	{
+		return c - '0';
+	}
+	
+	c |= 0x20;
+	return c >= 'a' && c <= 'z' ? c - 'a' + 10 : 36;
+}
+
+static size_t LT_SkipDigits(const char *text, size_t i, size_t len, unsigned base)
+{
+	while(i < len && LT_DigitValue(text[i]) < base)
+	{
+		i++;
+	}
+	
+	return i;
+}
+
+// Gives a number token the value of its text, which is a decimal, hex (0x),
+// binary (0b), octal (0o or a leading 0) or floating-point literal with an
+// optional suffix of letters and underscores.
+static void LT_ParseNumber(LT_Context *ctx, LT_Token *tk, const char *text, size_t len)
+{
+	size_t i = 0, start, intEnd, numEnd;
+	unsigned base = 10, digitBase;
+	LT_BOOL isFloat = LT_FALSE, hasExp = LT_FALSE;
+	
+	tk->numType = LT_NUM_BAD;
+	
+	if(len >= 2 && text[0] == '0')
+	{
+		switch(text[1] | 0x20)
+		{
+		case 'x': base = 16; i = 2; break;
+		case 'b': base = 2;  i = 2; break;
+		case 'o': base = 8;  i = 2; break;
+		}
+	}
+	
+	// Binary and octal digits are checked below, so "0b12" is bad rather than "0b1" with a suffix.
+	digitBase = base == 16 ? 16 : 10;
+	start = i;
+	i = intEnd = LT_SkipDigits(text, i, len, digitBase);
+	
+	if((base == 10 || base == 16) && i < len && text[i] == '.')
+	{
+		isFloat = LT_TRUE;
+		i = LT_SkipDigits(text, i + 1, len, digitBase);
+	}
+	
+	if(i == start || i == start + isFloat)
+	{
+		return;
+	}
+	
+	if((base == 10 || base == 16) && i < len && (text[i] | 0x20) == (base == 16 ? 'p' : 'e'))
+	{
+		size_t j = i + 1;
+		
+		if(j < len && (text[j] == '+' || text[j] == '-'))
+		{
+			j++;
+		}
+		
+		if(j < len && LT_DigitValue(text[j]) < 10)
+		{
+			isFloat = hasExp = LT_TRUE;
+			i = LT_SkipDigits(text, j, len, 10);
+		}
+		else if(j != i + 1)
+		{
+			return;
+		}
+	}
+	
+	// Hex floats need their exponent.
+	if(base == 16 && isFloat && !hasExp)
+	{
+		return;
+	}
+	
+	numEnd = i;
+	
+	for(; i < len; i++)
+	{
+		if(!(text[i] == '_' || ((text[i] | 0x20) >= 'a' && (text[i] | 0x20) <= 'z')))
+		{
+			return;
+		}
+	}
+	
+	tk->suffixLen = (unsigned)(len - numEnd);
+	
+	if(isFloat)
+	{
+		char local[128], *copy = local, *end;
+		char point = localeconv()->decimal_point[0];
+		double val;
+		
+		if(numEnd >= sizeof(local))
+		{
+			copy = LT_ArenaAlloc(ctx, numEnd + 1);
+		}
+		
+		for(i = 0; i < numEnd; i++)
+		{
+			copy[i] = text[i] == '.' ? point : text[i];
+		}
+		
+		copy[numEnd] = '\0';
+		val = strtod(copy, &end);
+		
+		if(end == copy + numEnd && val <= DBL_MAX)
+		{
+			tk->numType = LT_NUM_FLOAT;
+			tk->floatValue = val;
+		}
+		
+		if(copy != local)
+		{
+			LT_ArenaReAlloc(ctx, copy, numEnd + 1, 0);
+		}
+		
+		return;
+	}
+	
+	if(base == 10 && text[0] == '0' && intEnd > 1)
+	{
+		base = 8;
+		start = 1;
+	}
+	
+	tk->intValue = 0;
+	
+	for(i = start; i < intEnd; i++)
+	{
+		unsigned d = LT_DigitValue(text[i]);
+		
+		if(d >= base || tk->intValue > (ULLONG_MAX - d) / base)
+		{
+			return;
+		}
+		
+		tk->intValue = tk->intValue * base + d;
+	}
+	
+	tk->numType = LT_NUM_INT;
+	tk->floatValue = (double)tk->intValue;
+}
+
+static void LT_LexNumber(LT_Context *ctx, LT_Token *tk, int c)
+{
+	tk->kind = TOK_Number;
+	tk->spanPos = tk->pos;
+	
+	// Parsed numbers don't need a string of their own.
+	if(LT_UseSpans(ctx) || (ctx->cfg.parseNumbers && ctx->buf != NULL && !ctx->streaming))
+	{
+		const char *end = ctx->buf + ctx->bufLen;
+		
+		ctx->bufPos = LT_ScanNumber(ctx, ctx->buf + tk->spanPos, end) - ctx->buf;
+		tk->spanLen = tk->strlen = (unsigned)(ctx->bufPos - tk->spanPos);
+	}
+	else
+	{
+		LT_UnreadC(ctx, c);
+		
+		tk->string = LT_ReadNumberCtx(ctx);
+		tk->spanLen = (unsigned)(LT_Tell(ctx) - tk->spanPos);
+		tk->strlen = (unsigned)strlen(tk->string);
+	}
+	
+	if(ctx->cfg.parseNumbers)
+	{
+		if(ctx->buf != NULL)
+		{
+			LT_ParseNumber(ctx, tk, ctx->buf + tk->spanPos, tk->spanLen);
+		}
+		else
+		{
+			LT_ParseNumber(ctx, tk, tk->string, tk->strlen);
+		}
+	}
+}
+
+static void LT_LexIdent(LT_Context *ctx, LT_Token *tk, int c)
+{
+	size_t i = 0, cap = TOKEN_STR_BLOCK_LENGTH;
+	char *str;
+	
+	tk->kind = TOK_Identi;
+	tk->spanPos = tk->pos;
+	
+	if(ctx->buf != NULL)
+	{
+		const char *p = ctx->buf + ctx->bufPos, *end = ctx->buf + ctx->bufLen;
+		
+		p = ctx->scan[LT_SCAN_IDENT](p, end);
+		ctx->bufPos = p - ctx->buf;
+		tk->spanLen = tk->strlen = (unsigned)(ctx->bufPos - tk->spanPos);
+		
+		// Interned identifiers are copied from the span by LT_InternToken.
+		if(LT_UseSpans(ctx) || ctx->cfg.internIdents)
+		{
+			return;
+		}
+		
+		i = tk->spanLen;
+		str = LT_ArenaAlloc(ctx, i + 1);
+		memcpy(str, ctx->buf + tk->spanPos, i);
+		tk->string = LT_StrFinish(ctx, str, i + 1, i);
+		tk->strlen = (unsigned)i;
+		return;
+	}
+	
+	str = LT_ArenaAlloc(ctx, cap);
+	
+	while(c != EOF && (ctx->charFlags[c] & LT_CF_IDENT))
+	{
+		str = LT_StrReserve(ctx, str, &cap, i + 1);
+		
+		str[i++] = c;
+		
+		c = LT_ReadC(ctx);
+	}
+	
+	LT_UnreadC(ctx, c);
+	
+	tk->spanLen = (unsigned)i;
+	tk->string = LT_StrFinish(ctx, str, cap, i);
+	tk->strlen = (unsigned)i;
+}
+
+static LT_Token LT_Lex(LT_Context *ctx)
+{
+	LT_Token tk = { 0 };
+	const LT_OpTrans *op;
+	int c;
+	
+	tk.spanPos = -1;
+	
+	while(LT_TRUE)
+	{
+		if(ctx->buf != NULL)
+		{
+			const char *p = ctx->buf + ctx->bufPos, *end = ctx->buf + ctx->bufLen;
+			
+			ctx->bufPos = ctx->scan[LT_SCAN_BLANK](p, end) - ctx->buf;
+		}
+		
+		do
+		{
+			c = LT_ReadC(ctx);
+		}
+		while(c != EOF && ctx->charClass[c] == LT_CC_SPACE);
+		
+		if(c == EOF)
+		{
+			tk.kind = TOK_EOF;
+			tk.pos = LT_Tell(ctx);
+			return tk;
+		}
+		
+		tk.pos = LT_Tell(ctx) - 1;
+		
+		if(c != '/' || !ctx->cfg.skipComments || !LT_LexComment(ctx, &tk))
+		{
+			break;
+		}
+		
+		if(ctx->cfg.commentSpans)
+		{
+			return tk;
+		}
+	}
+	
+	switch(ctx->charClass[c])
+	{
+	case LT_CC_OPER:
+		op = &ltOpTrans[c];
+		tk.kind = op->kind;
+		
+		if(op->next[0] != '\0')
+		{
+			int next = LT_ReadC(ctx);
+			unsigned i;
+			
+			for(i = 0; i < 3 && op->next[i] != '\0'; i++)
+			{
+				if(next == op->next[i])
+				{
+					tk.kind = op->nextKind[i];
+					break;
+				}
+			}
+			
+			if(i == 3 || op->next[i] == '\0')
+			{
+				LT_UnreadC(ctx, next);
+			}
+		}
+		
+		if(tk.kind == TOK_ChrSeq)
+		{
+			LT_CharToken(ctx, &tk, c);
+		}
+		
+		return tk;
+	case LT_CC_STRING:
+		tk.kind = TOK_String;
+		LT_ReadStringCtx(ctx, &tk, c);
+		return tk;
+	case LT_CC_CHAR:
+		tk.kind = TOK_Charac;
+		LT_ReadStringCtx(ctx, &tk, c);
+		return tk;
+	case LT_CC_DIGIT:
+		LT_LexNumber(ctx, &tk, c);
+		return tk;
+	case LT_CC_IDENT:
+		LT_LexIdent(ctx, &tk, c);
+		
+		if(ctx->keyCount != 0 && LT_KeywordToken(ctx, &tk))
+		{
+			return tk;
+		}
+		
+		if(ctx->cfg.internIdents)
+		{
+			LT_InternToken(ctx, &tk);
+		}
+		
+		return tk;
+	}
+	
+	LT_CharToken(ctx, &tk, c);
+	
+	return tk;
+}
+
+// Lexes a token from a stream, or puts everything back if the token could
+// carry on into data that hasn't been fed yet.
+static LT_Token LT_StreamToken(LT_Context *ctx)
+{
+	size_t start = ctx->bufPos;
+	LT_ArenaMark mark = LT_MarkArena(ctx);
+	LT_BOOL assertError = ctx->assertError;
+	unsigned assertCount = ctx->assertCount;
+#ifndef LT_NO_STATS
+	size_t asserts = ctx->stats.asserts;
+#endif
+	LT_Token tk;
+	
+	ctx->hitEnd = LT_FALSE;
+	tk = LT_Lex(ctx);
+	
+	// Identifiers and numbers are scanned without reading past the end, so
+	// one that stops right at it might not be finished either.
+	if(!ctx->streamEnd && (ctx->hitEnd ||
+		(ctx->bufPos == ctx->bufLen && (tk.kind == TOK_Identi || tk.kind == TOK_Number || tk.kind >= TOK_Keywrd))))
+	{
+		ctx->bufPos = start;
+		LT_RewindArena(ctx, mark);
+		
+		// Errors raised on the way are dropped, but they've already been
+		// written over the oldest ones in the ring.
+		if(ctx->assertCount != assertCount)
+		{
+			unsigned raised = ctx->assertCount - assertCount;
+			unsigned intact = raised < LT_ERROR_RING ? LT_ERROR_RING - raised : 0;
+			
+			if(assertCount - ctx->errorBase > intact)
+			{
+				ctx->errorBase = assertCount - intact;
+			}
+		}
+		
+		ctx->assertError = assertError;
+		ctx->assertCount = assertCount;
+#ifndef LT_NO_STATS
+		ctx->stats.asserts = asserts;
+#endif
+		ctx->starved = LT_TRUE;
+		
+		memset(&tk, 0, sizeof(tk));
+		tk.kind = TOK_EOF;
+		tk.pos = (int)start;
+		tk.spanPos = -1;
+	}
+	else
+	{
+		ctx->starved = LT_FALSE;
+	}
+	
+	tk.pos += (int)ctx->streamBase;
+	
+	if(tk.spanPos >= 0)
+	{
+		tk.spanPos += (int)ctx->streamBase;
+	}
+	
+	tk.token = LT_KindName(ctx, tk.kind);
+	
+	return tk;
+}
+
+#ifndef LT_NO_STATS
+static inline void LT_CountToken(LT_Context *ctx, const LT_Token *tk, size_t bytes)
+{
+	ctx->stats.tokens[tk->kind < TOK_Keywrd ? tk->kind : TOK_Keywrd]++;
+	ctx->stats.bytes += bytes;
+}
+#endif
+
+static LT_Token LT_NextToken(LT_Context *ctx)
+{
+	LT_Token tk;
+	
+	if(ctx->streaming)
+	{
+		tk = LT_StreamToken(ctx);
+	}
+	else
+	{
+		tk = LT_Lex(ctx);
+		tk.token = LT_KindName(ctx, tk.kind);
+	}
+	
+	// A stream waiting for more data hasn't really returned anything.
+	if(!(ctx->streaming && ctx->starved))
+	{
+		LT_TokenLine(ctx, &tk);
+	}
+	
+	return tk;
+}
+
+// Notes where the next token starts, for LT_FailToken if lexing it runs
+// out of memory.
+static inline void LT_MarkToken(LT_Context *ctx)
+{
+	ctx->failMark = LT_MarkArena(ctx);
+	ctx->failStart = LT_Tell(ctx);
+}
+
+// Undoes the token that ran out of memory, which comes back as TOK_EOF at
+// its start. The source is left there so the caller can free something
+// and try again.
+static LT_Token LT_FailToken(LT_Context *ctx)
+{
+	long start = ctx->failStart;
+	LT_Token tk;
+	
+	LT_RewindArena(ctx, ctx->failMark);
+	
+	if(ctx->buf != NULL)
+	{
+		ctx->bufPos = (size_t)start;
+	}
+	else if(ctx->parseFile != NULL)
+	{
+		fseek(ctx->parseFile, start, SEEK_SET);
+	}
+	
+	ctx->starved = LT_FALSE;
+	
+	memset(&tk, 0, sizeof(tk));
+	tk.kind = TOK_EOF;
+	tk.token = LT_KindName(ctx, tk.kind);
+	tk.pos = (int)(start + (long)ctx->streamBase);
+	tk.spanPos = -1;
+	LT_TokenLine(ctx, &tk);
+	
+	return tk;
+}
+
+// LT_NextToken, counted and traced. A token that fails under a memory
+// limit jumps out of here and isn't either.
+static LT_Token LT_TakeToken(LT_Context *ctx)
+{
+	LT_Token tk;
+#ifndef LT_NO_STATS
+	long start = LT_Tell(ctx);
+#endif
+#ifndef LT_NO_TRACE
+	unsigned long long traceStart = LT_Tracing(ctx) ? LT_TraceClock() : 0;
+#endif
+	
+	tk = LT_NextToken(ctx);
+	
+	if(!(ctx->streaming && ctx->starved))
+	{
+#ifndef LT_NO_STATS
+		LT_CountToken(ctx, &tk, (size_t)(LT_Tell(ctx) - start));
+#endif
+	}
+	
+#ifndef LT_NO_TRACE
+	if(LT_Tracing(ctx))
+	{
+		LT_TraceToken(ctx, traceStart, tk.kind == TOK_EOF);
+	}
+#endif
+	
+	return tk;
+}
+
+// LT_GetTokens under a memory limit. The recovery point is set once for
+// the whole batch, since setjmp costs about as much as a short token, and
+// a token that runs out ends it.
+static size_t LT_LimitedTokens(LT_Context *ctx, LT_Token *out, size_t max)
+{
+	unsigned asserts = ctx->assertCount;
+	volatile size_t n = 0;
+	jmp_buf recover;
+	
+	if(setjmp(recover) != 0)
+	{
+		out[n] = LT_FailToken(ctx);
+		return n + 1;
+	}
+	
+	ctx->recover = &recover;
+	
+	while(n < max)
+	{
+		LT_Token *tk = &out[n];
+		
+		LT_MarkToken(ctx);
+		*tk = LT_TakeToken(ctx);
+		n++;
+		
+		if(tk->kind == TOK_EOF || ctx->assertCount != asserts)
+		{
+			break;
+		}
+	}
+	
+	ctx->recover = NULL;
+	return n;
+}
+
+LT_Token LT_GetTokenCtx(LT_Context *ctx)
+{
+	LT_Token tk;
+	
+	if(ctx->cfg.memLimit != 0)
+	{
+		LT_LimitedTokens(ctx, &tk, 1);
+		return tk;
+	}
+	
+	return LT_TakeToken(ctx);
+}
+
+LT_Token LT_GetToken()
+{
+	return LT_GetTokenCtx(LT_Default());
+}
+
+// Reads up to max tokens into out. Stops after TOK_EOF or a token that
+// raised an assertion, which is always the last one returned.
+size_t LT_GetTokensCtx(LT_Context *ctx, LT_Token *out, size_t max)
+{
+	unsigned asserts = ctx->assertCount;
+	size_t n = 0;
+	
+	if(ctx->cfg.memLimit != 0)
+	{
+		return LT_LimitedTokens(ctx, out, max);
+	}
+	
+	while(n < max)
+	{
+		LT_Token *tk = &out[n++];
+		
+		*tk = LT_TakeToken(ctx);
+		
+		if(tk->kind == TOK_EOF || ctx->assertCount != asserts)
+		{
+			break;
+		}
+	}
+	
+	return n;
+}
+
+size_t LT_GetTokens(LT_Token *out, size_t max)
+{
+	return LT_GetTokensCtx(LT_Default(), out, max);
+}
+
+/*
+ * Parallel tokenizing
+ */
+
+static unsigned LT_CPUCount(void)
+{
+#if defined(LT_NO_THREADS)
+	return 1;
+#elif defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (unsigned)info.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (unsigned)n : 1;
+#else
+	return 1;
+#endif
+}
+
+// Moves every arena chunk from one context into another, behind its
+// current chunk so that it stays the one being allocated from.
+static void LT_AdoptArena(LT_Context *ctx, LT_Context *from)
+{
+	LT_ArenaChunk *tail = from->arena;
+	
+	if(tail == NULL)
+	{
+		return;
+	}
+	
+	// The chunks count against this context's limit now.
+	while(LT_TRUE)
+	{
+		LT_Unreserve(from, sizeof(LT_ArenaChunk) + tail->size);
+		ctx->memUsed += sizeof(LT_ArenaChunk) + tail->size;
+		
+		if(tail->next == NULL)
+		{
+			break;
+		}
+		
+		tail = tail->next;
+	}
+	
+	if(ctx->arena == NULL)
+	{
+		ctx->arena = from->arena;
+	}
+	else
+	{
+		tail->next = ctx->arena->next;
+		ctx->arena->next = from->arena;
+	}
+	
+	from->arena = NULL;
+}
+
+// Adds the counters of a worker's context, other than its tokens. Its
+// asserts are counted as its tokens are kept, by LT_TakeChunkErrors.
+static void LT_MergeStats(LT_Context *ctx, LT_Context *from)
+{
+	LT_COUNT(ctx, allocs, from->stats.allocs);
+	LT_COUNT(ctx, allocBytes, from->stats.allocBytes);
+	LT_COUNT(ctx, conversions, from->stats.conversions);
+	LT_COUNT(ctx, strGrowths, from->stats.strGrowths);
+}
+
+// Under a memory limit, the recovery point is set once for the chunk, and
+// running out stops it at the token that failed. It's only armed while a
+// token is lexed, as it is for LT_GetToken.
+static void LT_LexChunk(LT_Context *ctx, LT_ParChunk *chunk)
+{
+	jmp_buf recover, *limited = NULL;
+	
+	ctx->bufPos = chunk->start;
+	chunk->stop = chunk->start;
+	
+	if(ctx->cfg.memLimit != 0)
+	{
+		if(setjmp(recover) != 0)
+		{
+			LT_FailToken(ctx);
+			chunk->ranOut = LT_TRUE;
+			return;
+		}
+		
+		limited = &recover;
+	}
+	
+	while(LT_TRUE)
+	{
+		unsigned asserts = ctx->assertCount;
+		LT_Token tk;
+		
+		LT_MarkToken(ctx);
+		ctx->recover = limited;
+		tk = LT_TakeToken(ctx);
+		ctx->recover = NULL;
+		
+		if(tk.kind == TOK_EOF || (size_t)tk.pos >= chunk->end)
+		{
+			break;
+		}
+		
+		if(chunk->count == chunk->cap)
+		{
+			chunk->cap = chunk->cap ? chunk->cap * 2 : (chunk->end - chunk->start) / 4 + 16;
+			chunk->tokens = LT_ReAlloc(ctx, chunk->tokens, chunk->cap * sizeof(LT_Token));
+		}
+		
+		for(; asserts != ctx->assertCount; asserts++)
+		{
+			if(chunk->errorCount == chunk->errorCap)
+			{
+				chunk->errorCap = chunk->errorCap ? chunk->errorCap * 2 : 16;
+				chunk->errorAt = LT_ReAlloc(ctx, chunk->errorAt, chunk->errorCap * sizeof(size_t));
+			}
+			
+			// A token can raise more errors than the ring holds, but then
+			// the last of them fill the chunk's ring anyway.
+			if(ctx->assertCount - asserts <= LT_ERROR_RING)
+			{
+				chunk->errors[chunk->errorCount % LT_ERROR_RING] = ctx->errorRing[asserts % LT_ERROR_RING];
+			}
+			
+			chunk->errorAt[chunk->errorCount++] = chunk->count;
+		}
+		
+		chunk->tokens[chunk->count++] = tk;
+		chunk->stop = ctx->bufPos;
+	}
+}
+
+static void LT_ParWork(LT_ParWorker *worker)
+{
+	size_t i;
+	
+	for(i = worker->first; i < worker->numChunks; i += worker->stride)
+	{
+		LT_LexChunk(worker->ctx, &worker->chunks[i]);
+	}
+}
+
+#ifndef LT_NO_THREADS
+#ifdef _WIN32
+static DWORD WINAPI LT_ParThread(LPVOID worker)
+{
+	LT_ParWork(worker);
+	return 0;
+}
+#else
+static void *LT_ParThread(void *worker)
+{
+	LT_ParWork(worker);
+	return NULL;
+}
+#endif
+#endif
+
+// Splits [start, end) into chunks that begin right after a newline.
+static LT_ParChunk *LT_SplitChunks(LT_Context *ctx, const char *buf, size_t start, size_t end, size_t want, size_t *numChunks)
+{
+	size_t len = end - start, step = len / (want ? want : 1), n = 0;
+	LT_ParChunk *chunks;
+	
+	if(step < LT_PARALLEL_MIN_CHUNK)
+	{
+		step = LT_PARALLEL_MIN_CHUNK;
+	}
+	
+	chunks = LT_Alloc(ctx, (len / step + 1) * sizeof(LT_ParChunk));
+	
+	while(start < end || n == 0)
+	{
+		size_t split = end;
+		
+		if(end - start > step)
+		{
+			const char *nl = memchr(buf + start + step, '\n', end - start - step);
+			
+			if(nl != NULL)
+			{
+				split = (nl - buf) + 1;
+			}
+		}
+		
+		memset(&chunks[n], 0, sizeof(LT_ParChunk));
+		chunks[n].start = start;
+		chunks[n].end = split;
+		n++;
+		
+		start = split;
+	}
+	
+	*numChunks = n;
+	return chunks;
+}
+
+static void LT_AddRun(LT_Context *ctx, LT_ParRun **runs, size_t *numRuns, size_t *cap, const LT_Token *tokens, size_t count)
+{
+	if(count == 0)
+	{
+		return;
+	}
+	
+	if(*numRuns == *cap)
+	{
+		*cap = *cap ? *cap * 2 : 16;
+		*runs = LT_ReAlloc(ctx, *runs, *cap * sizeof(LT_ParRun));
+	}
+	
+	(*runs)[*numRuns].tokens = tokens;
+	(*runs)[*numRuns].count = count;
+	(*numRuns)++;
+}
+
+// Finds the token in a chunk that starts at pos, or returns (size_t)-1.
+static size_t LT_FindChunkToken(const LT_ParChunk *chunk, size_t pos)
+{
+	size_t lo = 0, hi = chunk->count;
+	
+	while(lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		
+		if((size_t)chunk->tokens[mid].pos < pos)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	
+	return lo < chunk->count && (size_t)chunk->tokens[lo].pos == pos ? lo : (size_t)-1;
+}
+
+// Whether stitching is done with a chunk once its tokens are taken. If its
+// worker ran out of memory, it's emptied instead and the rest of it is
+// lexed while stitching.
+static LT_BOOL LT_ChunkTaken(LT_ParChunk *chunk)
+{
+	if(!chunk->ranOut)
+	{
+		return LT_TRUE;
+	}
+	
+	chunk->start = (size_t)-1;
+	chunk->count = chunk->errorCount = 0;
+	chunk->ranOut = LT_FALSE;
+	return LT_FALSE;
+}
+
+// Raises the errors of a chunk's tokens from from on, in order. Ones that
+// are no longer in the chunk's ring would have been pushed out of the
+// context's by the rest anyway, so they're only counted.
+static void LT_TakeChunkErrors(LT_Context *ctx, const LT_ParChunk *chunk, size_t from)
+{
+	size_t i = 0;
+	
+	while(i < chunk->errorCount && chunk->errorAt[i] < from)
+	{
+		i++;
+	}
+	
+	LT_COUNT(ctx, asserts, chunk->errorCount - i);
+	
+	if(chunk->errorCount - i > LT_ERROR_RING)
+	{
+		ctx->assertCount += (unsigned)(chunk->errorCount - i - LT_ERROR_RING);
+		i = chunk->errorCount - LT_ERROR_RING;
+	}
+	
+	for(; i < chunk->errorCount; i++)
+	{
+		LT_PushError(ctx, &chunk->errors[i % LT_ERROR_RING]);
+	}
+}
+
+// Lexes the rest of a buffer-backed source on several threads and returns
+// every token in order, ending with TOK_EOF. The array and its strings are
+// freed by LT_ReleaseStrings. Chunks are split at newlines and lexed as if
+// a token starts there; if one actually starts inside a token (such as a
+// string with a newline in it), it is lexed again from where the previous
+// chunk left off until it lines up with a token the chunk found.
+LT_Token *LT_TokenizeParallelCtx(LT_Context *ctx, unsigned threads, size_t *count)
+{
+	LT_ParChunk *chunks;
+	LT_ParWorker *workers;
+	LT_ParRun *runs = NULL;
+	LT_Token *out, *eof;
+	LT_Config workerCfg = ctx->cfg;
+	LT_BOOL memFailed = LT_FALSE;
+	size_t numChunks, numRuns = 0, runCap = 0, cur, start, i, n = 0;
+	unsigned t;
+#ifndef LT_NO_STATS
+	LT_Stats counted;
+#endif
+#ifndef LT_NO_TRACE
+	unsigned long long traceStart = LT_Tracing(ctx) ? LT_TraceClock() : 0;
+#endif
+	
+	*count = 0;
+	
+	// Workers don't intern, so that every symbol comes from this context.
+	// The buffer's already converted if it needed to be.
+	workerCfg.internIdents = LT_FALSE;
+#ifndef LT_NO_ICONV
+	workerCfg.doConvert = LT_FALSE;
+#endif
+	
+	if(LT_Raise(ctx, ctx->buf == NULL || ctx->streaming, "LT_TokenizeParallel", LT_ERR_NOT_BUFFER, 0, NULL))
+	{
+		return NULL;
+	}
+	
+	if(threads == 0)
+	{
+		threads = LT_CPUCount();
+	}
+	
+#ifdef LT_NO_THREADS
+	threads = 1;
+#endif
+	
+	chunks = LT_SplitChunks(ctx, ctx->buf, ctx->bufPos, ctx->bufLen, (size_t)threads * 4, &numChunks);
+	
+	if(threads > numChunks)
+	{
+		threads = (unsigned)numChunks;
+	}
+	
+	workers = LT_Alloc(ctx, threads * sizeof(LT_ParWorker));
+	
+	// The workers split what's left of the limit. One that runs out stops
+	// its chunk early, and the rest is lexed again while stitching.
+	if(ctx->cfg.memLimit != 0)
+	{
+		size_t left = LT_Budget(ctx, 0) ? ctx->cfg.memLimit - ctx->memUsed : 0;
+		
+		workerCfg.memLimit = left / threads != 0 ? left / threads : 1;
+	}
+	
+	// Every line is indexed up front, and the workers look lines up in the
+	// same index.
+	LT_IndexLines(ctx, ctx->bufLen);
+	
+	for(t = 0; t < threads; t++)
+	{
+		workers[t].ctx = LT_CreateContext(workerCfg);
+		workers[t].ctx->buf = ctx->buf;
+		workers[t].ctx->bufLen = ctx->bufLen;
+		workers[t].ctx->lineStarts = ctx->lineStarts;
+		workers[t].ctx->lineCount = ctx->lineCount;
+		workers[t].ctx->lineScanned = ctx->lineScanned;
+		workers[t].chunks = chunks;
+		workers[t].first = t;
+		workers[t].numChunks = numChunks;
+		workers[t].stride = threads;
+	}
+	
+	// The calling thread does the first worker's share itself. A thread that
+	// can't be started has its share done here too.
+#ifndef LT_NO_THREADS
+	{
+#ifdef _WIN32
+		HANDLE *handles = LT_Alloc(ctx, threads * sizeof(HANDLE));
+#else
+		pthread_t *handles = LT_Alloc(ctx, threads * sizeof(pthread_t));
+#endif
+		LT_BOOL *started = LT_Alloc(ctx, threads * sizeof(LT_BOOL));
+		
+		for(t = 1; t < threads; t++)
+		{
+#ifdef _WIN32
+			handles[t] = CreateThread(NULL, 0, LT_ParThread, &workers[t], 0, NULL);
+			started[t] = handles[t] != NULL;
+#else
+			started[t] = pthread_create(&handles[t], NULL, LT_ParThread, &workers[t]) == 0;
+#endif
+		}
+		
+		LT_ParWork(&workers[0]);
+		
+		for(t = 1; t < threads; t++)
+		{
+			if(!started[t])
+			{
+				LT_ParWork(&workers[t]);
+				continue;
+			}
+			
+#ifdef _WIN32
+			WaitForSingleObject(handles[t], INFINITE);
+			CloseHandle(handles[t]);
+#else
+			pthread_join(handles[t], NULL);
+#endif
+		}
+		
+		free(started);
+		free(handles);
+	}
+#else
+	LT_ParWork(&workers[0]);
+#endif
+	
+	for(t = 0; t < threads; t++)
+	{
+		LT_AdoptArena(ctx, workers[t].ctx);
+		LT_MergeStats(ctx, workers[t].ctx);
+		workers[t].ctx->buf = NULL;
+		workers[t].ctx->lineStarts = NULL;
+		LT_DestroyContext(workers[t].ctx);
+	}
+	
+	free(workers);
+	
+#ifndef LT_NO_STATS
+	counted = ctx->stats;
+#endif
+	
+	// Stitch the chunks together. cur is always where a token can start.
+	cur = start = ctx->bufPos;
+	
+	for(i = 0; i < numChunks;)
+	{
+		LT_ParChunk *chunk = &chunks[i];
+		LT_Token *tk;
+		size_t at;
+		
+		if(cur == chunk->start)
+		{
+			LT_AddRun(ctx, &runs, &numRuns, &runCap, chunk->tokens, chunk->count);
+			LT_TakeChunkErrors(ctx, chunk, 0);
+			cur = chunk->stop;
+			i += LT_ChunkTaken(chunk);
+			continue;
+		}
+		
+		if(cur >= chunk->end)
+		{
+			i++;
+			continue;
+		}
+		
+		ctx->bufPos = cur;
+		tk = LT_ArenaAlloc(ctx, sizeof(LT_Token));
+		*tk = LT_GetTokenCtx(ctx);
+		
+		if(tk->kind == TOK_EOF)
+		{
+			memFailed = (size_t)tk->pos != ctx->bufLen;
+			break;
+		}
+		
+		LT_AddRun(ctx, &runs, &numRuns, &runCap, tk, 1);
+		cur = ctx->bufPos;
+		
+		if((at = LT_FindChunkToken(chunk, tk->pos)) != (size_t)-1)
+		{
+			LT_AddRun(ctx, &runs, &numRuns, &runCap, chunk->tokens + at + 1, chunk->count - at - 1);
+			LT_TakeChunkErrors(ctx, chunk, at + 1);
+			cur = chunk->stop;
+			i += LT_ChunkTaken(chunk);
+		}
+	}
+	
+	for(i = 0; i < numRuns; i++)
+	{
+		n += runs[i].count;
+	}
+	
+	if(memFailed || LT_Raise(ctx, !LT_Budget(ctx, (n + 1) * sizeof(LT_Token)), "LT_TokenizeParallel", LT_ERR_MEMORY, (long)((n + 1) * sizeof(LT_Token)), NULL))
+	{
+		for(i = 0; i < numChunks; i++)
+		{
+			free(chunks[i].tokens);
+			free(chunks[i].errorAt);
+		}
+		
+		free(chunks);
+		free(runs);
+		return NULL;
+	}
+	
+	out = LT_ArenaAlloc(ctx, (n + 1) * sizeof(LT_Token));
+	
+	for(i = 0, n = 0; i < numRuns; i++)
+	{
+		memcpy(out + n, runs[i].tokens, runs[i].count * sizeof(LT_Token));
+		n += runs[i].count;
+	}
+	
+	for(i = 0; i < n; i++)
+	{
+		if(out[i].kind >= TOK_Keywrd)
+		{
+			// The workers' copies of the keywords are gone now.
+			out[i].string = (char *)ctx->keywords[out[i].kind - TOK_Keywrd].str;
+			out[i].token = out[i].string;
+		}
+		else if(ctx->cfg.internIdents && out[i].kind == TOK_Identi && out[i].symbol == 0)
+		{
+			LT_InternToken(ctx, &out[i]);
+		}
+	}
+	
+	for(i = 0; i < numChunks; i++)
+	{
+		free(chunks[i].tokens);
+		free(chunks[i].errorAt);
+	}
+	
+	free(chunks);
+	free(runs);
+	
+	ctx->bufPos = ctx->bufLen;
+	
+	eof = &out[n++];
+	memset(eof, 0, sizeof(LT_Token));
+	eof->kind = TOK_EOF;
+	eof->token = LT_TkNames[TOK_EOF];
+	eof->pos = (int)ctx->bufLen;
+	eof->spanPos = -1;
+	LT_TokenLine(ctx, eof);
+	
+#ifndef LT_NO_STATS
+	// Count the tokens handed back, not the ones lexed again while stitching.
+	memcpy(ctx->stats.tokens, counted.tokens, sizeof(counted.tokens));
+	ctx->stats.bytes = counted.bytes + (ctx->bufLen - start);
+	
+	for(i = 0; i < n; i++)
+	{
+		LT_CountToken(ctx, &out[i], 0);
+	}
+#endif
+	
+#ifndef LT_NO_TRACE
+	if(LT_Tracing(ctx))
+	{
+		LT_TraceEvent(ctx, "LT_TokenizeParallel", 'X', traceStart, n, NULL);
+	}
+#endif
+	
+	*count = n;
+	return out;
+}
+
+LT_Token *LT_TokenizeParallel(unsigned threads, size_t *count)
+{
+	return LT_TokenizeParallelCtx(LT_Default(), threads, count);
+}
+
+char *LT_ReadLiteralCtx(LT_Context *ctx)
+{
+	size_t i = 0;
+	size_t cap = TOKEN_STR_BLOCK_LENGTH;
+	int c;
+	char *str = LT_ArenaAlloc(ctx, cap);
+	
+	while(LT_TRUE)
+	{
+		c = LT_ReadC(ctx);
+		if(c == '\r' || c == '\n' || c == EOF) break;
+		
+		str = LT_StrReserve(ctx, str, &cap, i + 1);
+		
+		str[i++] = c;
+	}
+	
+	str[i++] = '\0';
+	
+	return LT_ArenaReAlloc(ctx, str, cap, i);
+}
+
+char *LT_ReadLiteral()
+{
+	return LT_ReadLiteralCtx(LT_Default());
+}
+
+void LT_SkipWhiteCtx(LT_Context *ctx)
+{
+	int c;
+	
+	if(ctx->buf != NULL)
+	{
+		const char *p = ctx->buf + ctx->bufPos, *end = ctx->buf + ctx->bufLen;
+		
+		ctx->bufPos = ctx->scan[LT_SCAN_SPACE](p, end) - ctx->buf;
+		return;
+	}
+	
+	c = LT_ReadC(ctx);
+	
+	while(c != EOF && (ctx->charFlags[c] & LT_CF_SPACE))
+	{
+		c = LT_ReadC(ctx);
+	}
+	
+	LT_UnreadC(ctx, c);
+}
+
+void LT_SkipWhite()
+{
+	LT_SkipWhiteCtx(LT_Default());
+}
+
+void LT_SkipWhite2Ctx(LT_Context *ctx)
+{
+	int c;
+	
+	if(ctx->buf != NULL)
+	{
+		const char *p = ctx->buf + ctx->bufPos, *end = ctx->buf + ctx->bufLen;
+		
+		ctx->bufPos = ctx->scan[LT_SCAN_BLANK2](p, end) - ctx->buf;
+		return;
+	}
+	
+	c = LT_ReadC(ctx);
+	
+	while(c != EOF && c != '\r' && c != '\n' && (ctx->charFlags[c] & LT_CF_SPACE))
+	{
+		c = LT_ReadC(ctx);
+	}
+	
+	LT_UnreadC(ctx, c);
+}
+
+void LT_SkipWhite2()
+{
+	LT_SkipWhite2Ctx(LT_Default());
+}
+
+const char *LT_GetSpanCtx(LT_Context *ctx, const LT_Token *tk)
+{
+	if(ctx->buf == NULL || ctx->streaming || tk->spanPos < 0)
+	{
+		return NULL;
+	}
+	
+	return ctx->buf + tk->spanPos;
+}
+
+const char *LT_GetSpan(const LT_Token *tk)
+{
+	return LT_GetSpanCtx(LT_Default(), tk);
+}
+
+char *LT_TokenStringCtx(LT_Context *ctx, LT_Token *tk)
+{
+	if(tk->hasEscapes)
+	{
+		return LT_DecodeStringCtx(ctx, tk);
+	}
+	
+	if(tk->string == NULL && tk->spanPos >= 0 && ctx->buf != NULL)
+	{
+		tk->string = LT_ArenaStrDup(ctx, ctx->buf + tk->spanPos, tk->spanLen);
+		tk->strlen = tk->spanLen;
+	}
+	
+	return tk->string;
+}
+
+char *LT_TokenString(LT_Token *tk)
+{
+	return LT_TokenStringCtx(LT_Default(), tk);
+}
+
+char *LT_DecodeStringCtx(LT_Context *ctx, LT_Token *tk)
+{
+	const char *span = LT_GetSpanCtx(ctx, tk);
+	size_t len;
+	char *str;
+	
+	if(!tk->hasEscapes)
+	{
+		return LT_TokenStringCtx(ctx, tk);
+	}
+	
+	if(tk->string != NULL || span == NULL)
+	{
+		return tk->string;
+	}
+	
+	str = LT_ArenaAlloc(ctx, tk->spanLen + 1);
+	len = LT_DecodeEscapes(ctx, str, span, tk->spanLen, tk->spanPos);
+	str = LT_StrFinish(ctx, str, tk->spanLen + 1, len);
+	
+	tk->string = str;
+	tk->strlen = (unsigned)len;
+	
+	return str;
+}
+
+char *LT_DecodeString(LT_Token *tk)
+{
+	return LT_DecodeStringCtx(LT_Default(), tk);
+}
+
+/*
+ * Statistics
+ */
+
+LT_Stats LT_GetStatsCtx(LT_Context *ctx)
+{
+#ifndef LT_NO_STATS
+	return ctx->stats;
+#else
+	LT_Stats stats;
+	
+	memset(&stats, 0, sizeof(LT_Stats));
+	return stats;
+#endif
+}
+
+LT_Stats LT_GetStats()
+{
+	return LT_GetStatsCtx(LT_Default());
+}
+
+void LT_ResetStatsCtx(LT_Context *ctx)
+{
+#ifndef LT_NO_STATS
+	memset(&ctx->stats, 0, sizeof(LT_Stats));
+#endif
+}
+
+void LT_ResetStats()
+{
+	LT_ResetStatsCtx(&defaultCtx);
+}
+
+/*
+ * Tracing
+ */
+
+// Starts recording events into a ring of maxEvents (or 16384 if 0), which
+// is allocated now so recording never allocates. Old events are dropped.
+LT_BOOL LT_StartTraceCtx(LT_Context *ctx, size_t maxEvents)
+{
+#ifndef LT_NO_TRACE
+	if(maxEvents == 0)
+	{
+		maxEvents = 16384;
+	}
+	
+	if(ctx->trace == NULL)
+	{
+		ctx->trace = LT_Alloc(ctx, sizeof(LT_Trace));
+		ctx->trace->events = NULL;
+		ctx->trace->cap = 0;
+	}
+	
+	if(ctx->trace->cap != maxEvents)
+	{
+		free(ctx->trace->events);
+		ctx->trace->events = LT_Alloc(ctx, maxEvents * sizeof(LT_TraceRecord));
+		ctx->trace->cap = maxEvents;
+	}
+	
+	ctx->trace->next = ctx->trace->count = 0;
+	ctx->trace->batchTokens = 0;
+	ctx->trace->batchBusy = 0;
+	ctx->trace->origin = LT_TraceClock();
+	ctx->trace->recording = LT_TRUE;
+	
+	return LT_TRUE;
+#else
+	return LT_FALSE;
+#endif
+}
+
+LT_BOOL LT_StartTrace(size_t maxEvents)
+{
+	return LT_StartTraceCtx(LT_Default(), maxEvents);
+}
+
+// Stops recording, keeping what was recorded for LT_DumpTrace.
+void LT_StopTraceCtx(LT_Context *ctx)
+{
+#ifndef LT_NO_TRACE
+	if(LT_Tracing(ctx))
+	{
+		LT_TraceFlushBatch(ctx);
+		ctx->trace->recording = LT_FALSE;
+	}
+#endif
+}
+
+void LT_StopTrace()
+{
+	LT_StopTraceCtx(&defaultCtx);
+}
+
+#ifndef LT_NO_TRACE
+static void LT_WriteJSONString(FILE *out, const char *str)
+{
+	fputc('"', out);
+	
+	for(; *str != '\0'; str++)
+	{
+		unsigned char c = *str;
+		
+		if(c == '"' || c == '\\')
+		{
+			fprintf(out, "\\%c", c);
+		}
+		else if(c < ' ' || c >= 0x7F)
+		{
+			fprintf(out, "\\u%04x", c);
+		}
+		else
+		{
+			fputc(c, out);
+		}
+	}
+	
+	fputc('"', out);
+}
+#endif
+
+// Writes the recorded events, oldest first, in the Chrome trace event format
+// that chrome://tracing and Perfetto load.
+LT_BOOL LT_DumpTraceCtx(LT_Context *ctx, const char *filePath)
+{
+#ifndef LT_NO_TRACE
+	LT_Trace *trace = ctx->trace;
+	FILE *out;
+	size_t i;
+	
+	if(LT_Raise(ctx, trace == NULL, "LT_DumpTrace", LT_ERR_NO_TRACE, 0, NULL))
+	{
+		return LT_FALSE;
+	}
+	
+	if(trace->recording)
+	{
+		LT_TraceFlushBatch(ctx);
+	}
+	
+	out = fopen(filePath, "w");
+	
+	if(out == NULL)
+	{
+		LT_Raise(ctx, LT_TRUE, "LT_DumpTrace", LT_ERR_SYSTEM, errno, NULL);
+		return LT_FALSE;
+	}
+	
+	fputs("{\"traceEvents\":[\n", out);
+	
+	for(i = 0; i < trace->count; i++)
+	{
+		const LT_TraceRecord *ev = &trace->events[(trace->next + trace->cap - trace->count + i) % trace->cap];
+		
+		fprintf(out, "{\"name\":\"%s\",\"cat\":\"lt\",\"ph\":\"%c\",\"pid\":1,\"tid\":1,\"ts\":%.3f",
+			ev->name, ev->phase, ev->start / 1000.0);
+		
+		if(ev->phase == 'X')
+		{
+			fprintf(out, ",\"dur\":%.3f", ev->dur / 1000.0);
+		}
+		else
+		{
+			fputs(",\"s\":\"t\"", out);
+		}
+		
+		fprintf(out, ",\"args\":{\"count\":%lu", (unsigned long)ev->count);
+		
+		if(ev->busy != 0)
+		{
+			fprintf(out, ",\"busy_us\":%.3f", ev->busy / 1000.0);
+		}
+		
+		if(ev->detail[0] != '\0')
+		{
+			fputs(",\"detail\":", out);
+			LT_WriteJSONString(out, ev->detail);
+		}
+		
+		fprintf(out, "}}%s\n", i + 1 < trace->count ? "," : "");
+	}
+	
+	fputs("],\"displayTimeUnit\":\"ms\"}\n", out);
+	
+	if(fclose(out) != 0)
+	{
+		LT_Raise(ctx, LT_TRUE, "LT_DumpTrace", LT_ERR_SYSTEM, errno, NULL);
+		return LT_FALSE;
+	}
+	
+	return LT_TRUE;
+#else
+	return LT_FALSE;
+#endif
+}
+
+LT_BOOL LT_DumpTrace(const char *filePath)
+{
+	return LT_DumpTraceCtx(LT_Default(), filePath);
+}
+
+/*
+ * Token caches
+ */
+
+#ifndef __GDCC__
+// A 64-bit hash of len bytes, eight at a time. It only has to tell sources
+// apart, not stand up to anyone trying to make two of them collide.
+static unsigned long long LT_HashBytes(unsigned long long hash, const void *data, size_t len)
+{
+	const unsigned long long mul = 0x9E3779B97F4A7C15ull;
+	const unsigned char *p = data;
+	
+	for(; len >= 8; p += 8, len -= 8)
+	{
+		unsigned long long word;
+		
+		memcpy(&word, p, 8);
+		hash = (hash ^ word) * mul;
+		hash ^= hash >> 32;
+	}
+	
+	for(; len != 0; p++, len--)
+	{
+		hash = (hash ^ *p) * mul;
+	}
+	
+	hash ^= hash >> 29;
+	hash *= mul;
+	return hash ^ (hash >> 32);
+}
+
+// Hashes whatever in the config changes what a source lexes to. Anything
+// that changes the source itself (converting, stripping) is already in the
+// source's hash.
+static unsigned long long LT_CacheConfigHash(LT_Context *ctx)
+{
+	unsigned char flags[] = {
+		ctx->cfg.escapeChars != 0,  ctx->cfg.spanTokens != 0,  ctx->cfg.internIdents != 0,
+		ctx->cfg.parseNumbers != 0, ctx->cfg.lazyEscapes != 0, ctx->cfg.skipComments != 0,
+		ctx->cfg.commentSpans != 0
+	};
+	unsigned long long hash = LT_HashBytes(LT_CACHE_VERSION, flags, sizeof(flags));
+	size_t i;
+	
+	hash = LT_HashBytes(hash, ctx->charClass, sizeof(ctx->charClass));
+	
+	for(i = 0; i < ctx->keyCount; i++)
+	{
+		hash = LT_HashBytes(hash, ctx->keywords[i].str, ctx->keywords[i].len + 1);
+	}
+	
+	return hash;
+}
+
+static void LT_CachePut(LT_Context *ctx, LT_CacheBuf *out, const void *data, size_t len)
+{
+	if(out->len + len > out->cap)
+	{
+		out->cap = out->cap ? out->cap : TOKEN_STR_BLOCK_LENGTH;
+		
+		while(out->len + len > out->cap)
+		{
+			out->cap *= 2;
+		}
+		
+		out->data = LT_ReAlloc(ctx, out->data, out->cap);
+	}
+	
+	if(len != 0)
+	{
+		memcpy(out->data + out->len, data, len);
+		out->len += len;
+	}
+}
+
+// Seven bits a byte, low bits first, with the top bit set on all but the
+// last. Signed values are zigzagged first so small negatives stay short.
+static void LT_CachePutNum(LT_Context *ctx, LT_CacheBuf *out, unsigned long long n)
+{
+	unsigned char bytes[10];
+	size_t len = 0;
+	
+	while(n >= 0x80)
+	{
+		bytes[len++] = (unsigned char)(n | 0x80);
+		n >>= 7;
+	}
+	
+	bytes[len++] = (unsigned char)n;
+	LT_CachePut(ctx, out, bytes, len);
+}
+
+static inline unsigned long long LT_ZigZag(long long n)
+{
+	return ((unsigned long long)n << 1) ^ (unsigned long long)(n >> 63);
+}
+
+static inline long long LT_UnZigZag(unsigned long long n)
+{
+	return (long long)(n >> 1) ^ -(long long)(n & 1);
+}
+
+static LT_BOOL LT_CacheGetNum(const unsigned char **p, const unsigned char *end, unsigned long long *n)
+{
+	unsigned shift = 0;
+	
+	*n = 0;
+	
+	while(*p < end && shift < 64)
+	{
+		unsigned char byte = *(*p)++;
+		
+		*n |= (unsigned long long)(byte & 0x7F) << shift;
+		
+		if(!(byte & 0x80))
+		{
+			return LT_TRUE;
+		}
+		
+		shift += 7;
+	}
+	
+	return LT_FALSE;
+}
+
+// Adds a string to a cache's strings unless it's already there, and returns
+// its offset. Strings can hold NULs from escapes, so they're compared by
+// length. slots is an open addressing table of pairs of offset + 1, length.
+static unsigned long long LT_CacheString(LT_Context *ctx, LT_CacheBuf *strs, LT_CacheBuf *slots, const char *str, size_t len)
+{
+	size_t mask = slots->cap / (2 * sizeof(size_t)) - 1, at, i, offset;
+	size_t *slot = (size_t *)slots->data;
+	
+	at = (size_t)LT_HashBytes(0, str, len) & mask;
+	
+	while(slot[at * 2] != 0)
+	{
+		if(slot[at * 2 + 1] == len && memcmp(strs->data + slot[at * 2] - 1, str, len) == 0)
+		{
+			return slot[at * 2] - 1;
+		}
+		
+		at = (at + 1) & mask;
+	}
+	
+	offset = strs->len;
+	slot[at * 2] = offset + 1;
+	slot[at * 2 + 1] = len;
+	LT_CachePut(ctx, strs, str, len);
+	LT_CachePut(ctx, strs, "", 1);
+	
+	// Keep the table at most half full.
+	if(++slots->len * 2 > mask + 1)
+	{
+		size_t *grown = LT_Alloc(ctx, slots->cap * 2);
+		
+		memset(grown, 0, slots->cap * 2);
+		
+		for(i = 0; i <= mask; i++)
+		{
+			if(slot[i * 2] != 0)
+			{
+				at = (size_t)LT_HashBytes(0, strs->data + slot[i * 2] - 1, slot[i * 2 + 1]) & (mask * 2 + 1);
+				
+				while(grown[at * 2] != 0)
+				{
+					at = (at + 1) & (mask * 2 + 1);
+				}
+				
+				grown[at * 2] = slot[i * 2];
+				grown[at * 2 + 1] = slot[i * 2 + 1];
+			}
+		}
+		
+		free(slots->data);
+		slots->data = (char *)grown;
+		slots->cap *= 2;
+	}
+	
+	return offset;
+}
+
+// Turns a cache's tokens back into LT_Tokens, checking everything that
+// could make them point outside the source or the strings.
+static LT_BOOL LT_DecodeCache(LT_Context *ctx, const LT_CacheHeader *head, const unsigned char *p, const char *strs,
+	const int *symbols, LT_Token *out)
+{
+	const unsigned char *end = p + head->tokBytes;
+	long long pos = 0, line = 0;
+	size_t i;
+	
+	for(i = 0; i < head->count; i++)
+	{
+		LT_Token *tk = &out[i];
+		unsigned long long flags, kind, delta, lineDelta, col, n;
+		
+		if(!LT_CacheGetNum(&p, end, &flags) || !LT_CacheGetNum(&p, end, &kind) ||
+			!LT_CacheGetNum(&p, end, &delta) || !LT_CacheGetNum(&p, end, &lineDelta) ||
+			!LT_CacheGetNum(&p, end, &col) || kind >= TOK_Keywrd + ctx->keyCount)
+		{
+			return LT_FALSE;
+		}
+		
+		pos += LT_UnZigZag(delta);
+		line += LT_UnZigZag(lineDelta);
+		
+		if(pos < 0 || (unsigned long long)pos > ctx->bufLen)
+		{
+			return LT_FALSE;
+		}
+		
+		memset(tk, 0, sizeof(LT_Token));
+		tk->kind = (int)kind;
+		tk->token = LT_KindName(ctx, tk->kind);
+		tk->pos = (int)pos;
+		tk->line = (int)line;
+		tk->col = (int)col;
+		tk->spanPos = -1;
+		tk->hasEscapes = (flags & LT_CACHE_ESCAPES) != 0;
+		
+		if(flags & LT_CACHE_SPAN)
+		{
+			unsigned long long len;
+			long long at;
+			
+			if(!LT_CacheGetNum(&p, end, &n) || !LT_CacheGetNum(&p, end, &len))
+			{
+				return LT_FALSE;
+			}
+			
+			at = pos + LT_UnZigZag(n);
+			
+			if(at < 0 || (unsigned long long)at > ctx->bufLen || len > ctx->bufLen - (size_t)at)
+			{
+				return LT_FALSE;
+			}
+			
+			tk->spanPos = (int)at;
+			tk->spanLen = tk->strlen = (unsigned)len;
+		}
+		
+		if(flags & LT_CACHE_STRLEN)
+		{
+			if(!LT_CacheGetNum(&p, end, &n))
+			{
+				return LT_FALSE;
+			}
+			
+			tk->strlen = (unsigned)n;
+		}
+		
+		if(flags & LT_CACHE_STRING)
+		{
+			if(!LT_CacheGetNum(&p, end, &n) || n >= head->strBytes || tk->strlen >= head->strBytes - n)
+			{
+				return LT_FALSE;
+			}
+			
+			tk->string = (char *)strs + n;
+		}
+		else if(flags & LT_CACHE_SYMBOL)
+		{
+			if(!LT_CacheGetNum(&p, end, &n) || n == 0 || n > head->symCount)
+			{
+				return LT_FALSE;
+			}
+			
+			tk->symbol = symbols[n];
+			tk->string = (char *)ctx->symbols[tk->symbol - 1].str;
+		}
+		else if(kind >= TOK_Keywrd)
+		{
+			tk->string = (char *)tk->token;
+		}
+		
+		if(flags & LT_CACHE_NUMBER)
+		{
+			unsigned long long type, suffix;
+			
+			if(!LT_CacheGetNum(&p, end, &type) || !LT_CacheGetNum(&p, end, &suffix) ||
+				!LT_CacheGetNum(&p, end, &tk->intValue) || end - p < (long)sizeof(double))
+			{
+				return LT_FALSE;
+			}
+			
+			tk->numType = (int)type;
+			tk->suffixLen = (unsigned)suffix;
+			memcpy(&tk->floatValue, p, sizeof(double));
+			p += sizeof(double);
+		}
+	}
+	
+	return p == end;
+}
+
+// Checks that a cache was made from the open source with the same config
+// and is all there, and turns it back into tokens. The hash of the source
+// and of the cache itself are left until last, since they're the only
+// checks that cost anything.
+static LT_Token *LT_ReadCache(LT_Context *ctx, const char *file, size_t size, size_t *count)
+{
+	LT_CacheHeader head;
+	const char *syms, *strs, *end;
+	size_t need, i;
+	LT_ArenaMark mark;
+	LT_Token *out;
+	char *own;
+	int *symbols;
+	
+	if(size < sizeof(LT_CacheHeader))
+	{
+		return NULL;
+	}
+	
+	memcpy(&head, file, sizeof(LT_CacheHeader));
+	
+	if(memcmp(head.magic, "LTTC", 4) != 0 || head.version != LT_CACHE_VERSION || head.headerSize != sizeof(LT_CacheHeader) ||
+		head.srcLen != ctx->bufLen || head.cfgHash != LT_CacheConfigHash(ctx) || head.count == 0 ||
+		head.symBytes > size || head.strBytes > size || head.tokBytes > size ||
+		head.symBytes + head.strBytes + head.tokBytes != size - sizeof(LT_CacheHeader) ||
+		head.symCount > head.symBytes || head.count > head.tokBytes / 5)
+	{
+		return NULL;
+	}
+	
+	syms = file + sizeof(LT_CacheHeader);
+	strs = syms + head.symBytes;
+	
+	if((head.symBytes != 0 && syms[head.symBytes - 1] != '\0') || (head.strBytes != 0 && strs[head.strBytes - 1] != '\0') ||
+		head.srcHash != LT_HashBytes(0, ctx->buf, ctx->bufLen) ||
+		head.bodyHash != LT_HashBytes(LT_HashBytes(LT_HashBytes(0, syms, head.symBytes), strs, head.strBytes),
+			strs + head.strBytes, head.tokBytes))
+	{
+		return NULL;
+	}
+	
+	need = head.count * sizeof(LT_Token) + head.strBytes;
+	
+	if(LT_Raise(ctx, !LT_Budget(ctx, need), "LT_LoadTokens", LT_ERR_MEMORY, (long)need, NULL))
+	{
+		return NULL;
+	}
+	
+	symbols = LT_Alloc(ctx, (head.symCount + 1) * sizeof(int));
+	end = syms + head.symBytes;
+	
+	for(i = 1; i <= head.symCount; i++)
+	{
+		size_t len;
+		
+		if(syms == end)
+		{
+			free(symbols);
+			return NULL;
+		}
+		
+		len = strlen(syms);
+		symbols[i] = LT_InternString(ctx, syms, len);
+		syms += len + 1;
+	}
+	
+	// The strings are copied in one piece, so they last as long as lexed
+	// ones do and the cache doesn't have to stay open.
+	mark = LT_MarkArena(ctx);
+	own = LT_ArenaAlloc(ctx, head.strBytes + 1);
+	memcpy(own, strs, head.strBytes);
+	out = LT_ArenaAlloc(ctx, head.count * sizeof(LT_Token));
+	
+	if(!LT_DecodeCache(ctx, &head, (const unsigned char *)strs + head.strBytes, own, symbols, out))
+	{
+		LT_RewindArena(ctx, mark);
+		out = NULL;
+	}
+	
+	free(symbols);
+	
+	*count = out != NULL ? (size_t)head.count : 0;
+	return out;
+}
+#endif
+
+// Writes tokens lexed from the open source to a cache file, keyed by a
+// hash of the source and of the config. Symbols are written by name and
+// other strings only once each. Keywords' strings and spans aren't written.
+LT_BOOL LT_SaveTokensCtx(LT_Context *ctx, const char *cachePath, const LT_Token *tokens, size_t count)
+{
+#ifndef __GDCC__
+	LT_CacheHeader head;
+	LT_CacheBuf syms = { 0 }, strs = { 0 }, slots = { 0 }, toks = { 0 };
+	unsigned *symIndex;
+	long long pos = 0, line = 0;
+	size_t symCount = 0, i;
+	FILE *out;
+	LT_BOOL ok;
+	
+	if(LT_Raise(ctx, ctx->buf == NULL || ctx->streaming, "LT_SaveTokens", LT_ERR_NOT_BUFFER, 0, NULL))
+	{
+		return LT_FALSE;
+	}
+	
+	symIndex = LT_Alloc(ctx, (ctx->symCount + 1) * sizeof(unsigned));
+	memset(symIndex, 0, (ctx->symCount + 1) * sizeof(unsigned));
+	
+	slots.cap = 256 * 2 * sizeof(size_t);
+	slots.data = LT_Alloc(ctx, slots.cap);
+	memset(slots.data, 0, slots.cap);
+	
+	for(i = 0; i < count; i++)
+	{
+		const LT_Token *tk = &tokens[i];
+		unsigned flags = 0, symbol = 0;
+		unsigned long long string = 0;
+		
+		if(tk->spanPos >= 0)
+		{
+			flags |= LT_CACHE_SPAN;
+		}
+		
+		if(tk->spanPos < 0 ? tk->strlen != 0 : tk->strlen != tk->spanLen)
+		{
+			flags |= LT_CACHE_STRLEN;
+		}
+		
+		if(tk->hasEscapes)
+		{
+			flags |= LT_CACHE_ESCAPES;
+		}
+		
+		if(tk->numType != LT_NUM_NONE || tk->suffixLen != 0 || tk->intValue != 0 || tk->floatValue != 0)
+		{
+			flags |= LT_CACHE_NUMBER;
+		}
+		
+		if(tk->kind < TOK_Keywrd && tk->string != NULL)
+		{
+			if(tk->symbol > 0 && (size_t)tk->symbol <= ctx->symCount)
+			{
+				if(symIndex[tk->symbol] == 0)
+				{
+					const LT_Symbol *sym = &ctx->symbols[tk->symbol - 1];
+					
+					LT_CachePut(ctx, &syms, sym->str, sym->len + 1);
+					symIndex[tk->symbol] = (unsigned)++symCount;
+				}
+				
+				symbol = symIndex[tk->symbol];
+				flags |= LT_CACHE_SYMBOL;
+			}
+			else
+			{
+				string = LT_CacheString(ctx, &strs, &slots, tk->string, tk->strlen);
+				flags |= LT_CACHE_STRING;
+			}
+		}
+		
+		LT_CachePutNum(ctx, &toks, flags);
+		LT_CachePutNum(ctx, &toks, (unsigned long long)tk->kind);
+		LT_CachePutNum(ctx, &toks, LT_ZigZag(tk->pos - pos));
+		LT_CachePutNum(ctx, &toks, LT_ZigZag(tk->line - line));
+		LT_CachePutNum(ctx, &toks, (unsigned long long)(unsigned)tk->col);
+		pos = tk->pos;
+		line = tk->line;
+		
+		if(flags & LT_CACHE_SPAN)
+		{
+			LT_CachePutNum(ctx, &toks, LT_ZigZag((long long)tk->spanPos - tk->pos));
+			LT_CachePutNum(ctx, &toks, tk->spanLen);
+		}
+		
+		if(flags & LT_CACHE_STRLEN)
+		{
+			LT_CachePutNum(ctx, &toks, tk->strlen);
+		}
+		
+		if(flags & LT_CACHE_STRING)
+		{
+			LT_CachePutNum(ctx, &toks, string);
+		}
+		else if(flags & LT_CACHE_SYMBOL)
+		{
+			LT_CachePutNum(ctx, &toks, symbol);
+		}
+		
+		if(flags & LT_CACHE_NUMBER)
+		{
+			LT_CachePutNum(ctx, &toks, (unsigned long long)(unsigned)tk->numType);
+			LT_CachePutNum(ctx, &toks, tk->suffixLen);
+			LT_CachePutNum(ctx, &toks, tk->intValue);
+			LT_CachePut(ctx, &toks, &tk->floatValue, sizeof(double));
+		}
+	}
+	
+	memset(&head, 0, sizeof(head));
+	memcpy(head.magic, "LTTC", 4);
+	head.version = LT_CACHE_VERSION;
+	head.headerSize = sizeof(LT_CacheHeader);
+	head.srcHash = LT_HashBytes(0, ctx->buf, ctx->bufLen);
+	head.cfgHash = LT_CacheConfigHash(ctx);
+	head.srcLen = ctx->bufLen;
+	head.count = count;
+	head.symCount = symCount;
+	head.symBytes = syms.len;
+	head.strBytes = strs.len;
+	head.tokBytes = toks.len;
+	head.bodyHash = LT_HashBytes(LT_HashBytes(LT_HashBytes(0, syms.data, syms.len), strs.data, strs.len), toks.data, toks.len);
+	
+	if((out = fopen(cachePath, "wb")) != NULL)
+	{
+		fwrite(&head, sizeof(head), 1, out);
+		
+		if(syms.len != 0)
+		{
+			fwrite(syms.data, 1, syms.len, out);
+		}
+		
+		if(strs.len != 0)
+		{
+			fwrite(strs.data, 1, strs.len, out);
+		}
+		
+		if(toks.len != 0)
+		{
+			fwrite(toks.data, 1, toks.len, out);
+		}
+		
+		ok = !ferror(out);
+		ok = fclose(out) == 0 && ok;
+	}
+	else
+	{
+		ok = LT_FALSE;
+	}
+	
+	LT_Raise(ctx, !ok, "LT_SaveTokens", LT_ERR_SYSTEM, errno, NULL);
+	
+	free(symIndex);
+	free(syms.data);
+	free(strs.data);
+	free(slots.data);
+	free(toks.data);
+	
+	return ok;
+#else
+	return LT_FALSE;
+#endif
+}
+
+LT_BOOL LT_SaveTokens(const char *cachePath, const LT_Token *tokens, size_t count)
+{
+	return LT_SaveTokensCtx(LT_Default(), cachePath, tokens, count);
+}
+
+// Maps a cache in and, if it was made from the open source with the same
+// config, returns its tokens as if LT_TokenizeParallel had lexed them.
+// Otherwise, returns NULL without raising anything and leaves the source
+// where it was.
+LT_Token *LT_LoadTokensCtx(LT_Context *ctx, const char *cachePath, size_t *count)
+{
+#ifndef __GDCC__
+	LT_Token *out = NULL;
+	void *base = NULL;
+	char *data = NULL;
+	size_t size = 0;
+#ifndef LT_NO_TRACE
+	unsigned long long traceStart = LT_Tracing(ctx) ? LT_TraceClock() : 0;
+#endif
+	
+	*count = 0;
+	
+	if(LT_Raise(ctx, ctx->buf == NULL || ctx->streaming, "LT_LoadTokens", LT_ERR_NOT_BUFFER, 0, NULL))
+	{
+		return NULL;
+	}
+	
+#ifndef LT_NO_MMAP
+	if(!LT_MapWhole(cachePath, &base, &size))
+	{
+		return NULL;
+	}
+	
+	if(base == NULL)
+#endif
+	{
+		FILE *fp = fopen(cachePath, "rb");
+		
+		if(fp == NULL)
+		{
+			return NULL;
+		}
+		
+		data = LT_ReadWholeFile(ctx, "LT_LoadTokens", fp, &size);
+		fclose(fp);
+	}
+	
+	if(base != NULL || data != NULL)
+	{
+		out = LT_ReadCache(ctx, base != NULL ? base : data, size, count);
+	}
+	
+#ifndef LT_NO_MMAP
+	if(base != NULL)
+	{
+		LT_Unmap(base, size);
+	}
+#endif
+	
+	free(data);
+	
+	if(out != NULL)
+	{
+		ctx->bufPos = ctx->bufLen;
+	}
+	
+#ifndef LT_NO_TRACE
+	if(LT_Tracing(ctx))
+	{
+		LT_TraceEvent(ctx, "LT_LoadTokens", 'X', traceStart, *count, cachePath);
+	}
+#endif
+	
+	return out;
+#else
+	*count = 0;
+	return NULL;
+#endif
+}
+
+LT_Token *LT_LoadTokens(const char *cachePath, size_t *count)
+{
+	return LT_LoadTokensCtx(LT_Default(), cachePath, count);
+}
+
+/*
+ * Documents
+ */
+
+static void LT_DocReserve(LT_Document *doc, size_t count)
+{
+	if(count > doc->tokCap)
+	{
+		size_t newCap = doc->tokCap ? doc->tokCap : 256;
+		
+		while(newCap < count)
+		{
+			newCap *= 2;
+		}
+		
+		doc->tokens = LT_ReAlloc(doc->ctx, doc->tokens, newCap * sizeof(LT_Token));
+		doc->tokCap = newCap;
+	}
+}
+
+// Points the document's context at its text at pos. It isn't opened again,
+// so the line index is kept and the text isn't stripped again.
+static void LT_DocOpen(LT_Document *doc, size_t pos)
+{
+	LT_Context *ctx = doc->ctx;
+	
+	LT_PlaceErrors(ctx);
+	
+	ctx->buf = doc->stripped != NULL ? doc->stripped : doc->text;
+	ctx->bufLen = doc->len;
+	ctx->bufPos = pos;
+}
+
+// Strips the text from start to end into the stripped copy, widened to
+// characters whose bytes are all unchanged on either side. A byte is only
+// stripped for what it and the bytes after it in its character are, so
+// nothing outside those can change.
+static void LT_DocStrip(LT_Document *doc, size_t start, size_t end)
+{
+	const unsigned char *text = (const unsigned char *)doc->text;
+	
+	if(start != 0)
+	{
+		start--;
+	}
+	
+	while(start != 0 && (text[start] & 0xC0) == 0x80)
+	{
+		start--;
+	}
+	
+	while(end < doc->len && (text[end] & 0xC0) == 0x80)
+	{
+		end++;
+	}
+	
+	memcpy(doc->stripped + start, doc->text + start, end - start);
+	LT_StripInvalid(doc->ctx, doc->stripped + start, end - start, LT_FALSE);
+}
+
+// Moves the line index past an edit along, so only the inserted text has to
+// be looked through for lines.
+static void LT_DocMoveLines(LT_Document *doc, size_t offset, size_t removed, const char *inserted, size_t insertedLen)
+{
+	LT_Context *ctx = doc->ctx;
+	size_t keep, tail = 0, added = 0, i;
+	const char *nl;
+	
+	// Lines starting at or before the edit are still where they were.
+	if(ctx->lineCount == 0 || ctx->lineScanned <= offset)
+	{
+		return;
+	}
+	
+	keep = LT_LineOf(ctx, offset) + 1;
+	
+	for(i = 0; i < insertedLen && (nl = memchr(inserted + i, '\n', insertedLen - i)) != NULL; i = nl - inserted + 1)
+	{
+		added++;
+	}
+	
+	if(ctx->lineScanned > offset + removed)
+	{
+		tail = ctx->lineCount - (LT_LineOf(ctx, offset + removed) + 1);
+		ctx->lineScanned = ctx->lineScanned - removed + insertedLen;
+	}
+	else
+	{
+		ctx->lineScanned = offset + insertedLen;
+	}
+	
+	LT_GrowLines(ctx, keep + added + tail);
+	memmove(ctx->lineStarts + keep + added, ctx->lineStarts + ctx->lineCount - tail, tail * sizeof(size_t));
+	
+	for(i = keep + added; i < keep + added + tail; i++)
+	{
+		ctx->lineStarts[i] = ctx->lineStarts[i] - removed + insertedLen;
+	}
+	
+	for(i = 0; i < insertedLen && (nl = memchr(inserted + i, '\n', insertedLen - i)) != NULL; i = nl - inserted + 1)
+	{
+		ctx->lineStarts[keep++] = offset + (size_t)(nl - inserted) + 1;
+	}
+	
+	ctx->lineCount = keep + tail;
+	ctx->lineHint = 0;
+}
+
+// Lexes the whole document again, which also frees the strings of every
+// token that's been replaced so far.
+static void LT_DocLexAll(LT_Document *doc)
+{
+	LT_Token tk;
+	
+	LT_ReleaseStringsCtx(doc->ctx);
+	LT_DocOpen(doc, 0);
+	
+	doc->count = 0;
+	doc->dropped = 0;
+	
+	do
+	{
+		tk = LT_GetTokenCtx(doc->ctx);
+		LT_DocReserve(doc, doc->count + 1);
+		doc->tokens[doc->count++] = tk;
+	}
+	while(tk.kind != TOK_EOF);
+}
+
+LT_Document *LT_CreateDocument(LT_Config cfg, const char *text, size_t len)
+{
+	LT_Document *doc = LT_Alloc(NULL, sizeof(LT_Document));
+	
+	memset(doc, 0, sizeof(LT_Document));
+	
+	doc->ctx = LT_CreateContext(cfg);
+	
+	// The text is converted once and kept that way, so edits, tokens and the
+	// text all agree and nothing has to be converted again. If it can't be,
+	// the text is kept as it was.
+#ifndef LT_NO_ICONV
+	if(doc->ctx->cfg.doConvert && LT_OpenMemoryCtx(doc->ctx, text, len))
+	{
+		text = doc->ctx->buf;
+		len = doc->ctx->bufLen;
+	}
+#endif
+	
+	doc->cap = len + 1;
+	doc->text = LT_Alloc(doc->ctx, doc->cap);
+	doc->len = len;
+	
+	if(len != 0)
+	{
+		memcpy(doc->text, text, len);
+	}
+	
+#ifndef LT_NO_ICONV
+	if(doc->ctx->cfg.doConvert)
+	{
+		LT_Config plain = doc->ctx->cfg;
+		
+		LT_CloseFileCtx(doc->ctx);
+		plain.doConvert = LT_FALSE;
+		LT_SetConfigCtx(doc->ctx, plain);
+	}
+#endif
+	
+	if(doc->ctx->cfg.stripInvalid)
+	{
+		doc->stripped = LT_Alloc(doc->ctx, doc->cap);
+		LT_DocStrip(doc, 0, len);
+	}
+	
+	LT_DocLexAll(doc);
+	
+	return doc;
+}
+
+void LT_DestroyDocument(LT_Document *doc)
+{
+	if(doc != NULL)
+	{
+		LT_DestroyContext(doc->ctx);
+		free(doc->tokens);
+		free(doc->text);
+		free(doc->stripped);
+		free(doc);
+	}
+}
+
+// Replaces removed bytes at offset with insertedLen bytes of inserted.
+// Lexing restarts at the last token that starts before the edit, since it
+// could have looked at the changed text, and stops once a token starts at
+// the same place as an old token after the edit. From there on the text is
+// the same, so the rest of the old tokens are only moved along. Assertions
+// from before are cleared, and only ones from the re-lexed part are kept.
+// The line index and the stripped text are patched the same way.
+LT_BOOL LT_ApplyEdit(LT_Document *doc, size_t offset, size_t removed, const char *inserted, size_t insertedLen)
+{
+	LT_Context *ctx = doc->ctx;
+	LT_Token *relexed = NULL;
+	size_t numRelexed = 0, relexCap = 0, oldEnd = offset + removed, first, sync, lo, hi, i;
+	long delta = (long)insertedLen - (long)removed;
+	int oldLine, lineDelta = 0;
+	
+	LT_ClearErrorsCtx(ctx);
+	
+	if(LT_Raise(ctx, offset > doc->len || removed > doc->len - offset, "LT_ApplyEdit", LT_ERR_EDIT_RANGE, 0, NULL) ||
+		LT_Raise(ctx, inserted == NULL && insertedLen != 0, "LT_ApplyEdit", LT_ERR_NULL_INSERT, 0, NULL))
+	{
+		return LT_FALSE;
+	}
+	
+	// Edit the text.
+	if(doc->len - removed + insertedLen + 1 > doc->cap)
+	{
+		while(doc->len - removed + insertedLen + 1 > doc->cap)
+		{
+			doc->cap *= 2;
+		}
+		
+		doc->text = LT_ReAlloc(doc->ctx, doc->text, doc->cap);
+		
+		if(doc->stripped != NULL)
+		{
+			doc->stripped = LT_ReAlloc(doc->ctx, doc->stripped, doc->cap);
+		}
+	}
+	
+	memmove(doc->text + offset + insertedLen, doc->text + oldEnd, doc->len - oldEnd);
+	
+	if(insertedLen != 0)
+	{
+		memcpy(doc->text + offset, inserted, insertedLen);
+	}
+	
+	LT_DocMoveLines(doc, offset, removed, inserted, insertedLen);
+	doc->len = doc->len - removed + insertedLen;
+	
+	if(doc->stripped != NULL)
+	{
+		memmove(doc->stripped + offset + insertedLen, doc->stripped + oldEnd, doc->len - offset - insertedLen);
+		LT_DocStrip(doc, offset, offset + insertedLen);
+	}
+	
+	// Find the last token starting before the edit.
+	lo = 0;
+	hi = doc->count;
+	
+	while(lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		
+		if((size_t)doc->tokens[mid].pos < offset)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	
+	first = lo != 0 ? lo - 1 : 0;
+	
+	LT_DocOpen(doc, lo != 0 ? (size_t)doc->tokens[first].pos : 0);
+	
+	// Re-lex until we meet an old token. TOK_EOF always matches.
+	for(sync = first;;)
+	{
+		LT_Token tk = LT_GetTokenCtx(ctx);
+		
+		// Only running out of memory ends the text early. Lexing it all
+		// again frees every replaced string, which may be enough.
+		if(tk.kind == TOK_EOF && (size_t)tk.pos != doc->len)
+		{
+			free(relexed);
+			LT_DocLexAll(doc);
+			return (size_t)doc->tokens[doc->count - 1].pos == doc->len;
+		}
+		
+		while(sync < doc->count && ((size_t)doc->tokens[sync].pos < oldEnd || doc->tokens[sync].pos + delta < tk.pos))
+		{
+			sync++;
+		}
+		
+		if(sync < doc->count && doc->tokens[sync].pos + delta == tk.pos)
+		{
+			break;
+		}
+		
+		if(numRelexed == relexCap)
+		{
+			relexCap = relexCap ? relexCap * 2 : 16;
+			relexed = LT_ReAlloc(doc->ctx, relexed, relexCap * sizeof(LT_Token));
+		}
+		
+		relexed[numRelexed++] = tk;
+	}
+	
+	// Swap the old tokens out for the new ones and move the rest along.
+	LT_DocReserve(doc, doc->count - (sync - first) + numRelexed);
+	memmove(doc->tokens + first + numRelexed, doc->tokens + sync, (doc->count - sync) * sizeof(LT_Token));
+	
+	if(numRelexed != 0)
+	{
+		memcpy(doc->tokens + first, relexed, numRelexed * sizeof(LT_Token));
+	}
+	
+	doc->dropped += sync - first;
+	doc->count = doc->count - (sync - first) + numRelexed;
+	
+	// Tokens on the line the edit ended on are looked up again, and the ones
+	// on later lines only move down by as many lines as that one did.
+	oldLine = doc->tokens[first + numRelexed].line;
+	
+	for(i = first + numRelexed; i < doc->count; i++)
+	{
+		LT_Token *tk = &doc->tokens[i];
+		
+		tk->pos += delta;
+		
+		if(tk->spanPos >= 0)
+		{
+			tk->spanPos += delta;
+		}
+		
+		if(tk->line == oldLine)
+		{
+			LT_TokenLine(ctx, tk);
+			lineDelta = tk->line - oldLine;
+		}
+		else
+		{
+			tk->line += lineDelta;
+		}
+	}
+	
+	free(relexed);
+	
+	// Old token strings stay in the arena until it's cleared, so lex
+	// everything again once there are more of them than live tokens.
+	if(doc->dropped > doc->count + 1024)
+	{
+		LT_DocLexAll(doc);
+	}
+	
+	return LT_TRUE;
+}
+
+// The tokens are valid until the next edit.
+const LT_Token *LT_DocumentTokens(LT_Document *doc, size_t *count)
+{
+	*count = doc->count;
+	return doc->tokens;
+}
+
+const char *LT_DocumentText(LT_Document *doc, size_t *len)
+{
+	*len = doc->len;
+	return doc->text;
+}
+
+LT_Context *LT_DocumentContext(LT_Document *doc)
+{
+	return doc->ctx;
+}
@@ -1,176 +1,393 @@
-/*
-Copyright (c) 2015 Benjamin Moir <bennyboy.private@hotmail.com.au>
-Copyright (c) 2015 Marrub <marrub@greyserv.net>
-
-Permission is hereby granted, free of charge, to any person obtaining a copy
-of this software and associated documentation files (the "Software"), to deal
-in the Software without restriction, including without limitation the rights
-to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-copies of the Software, and to permit persons to whom the Software is
-furnished to do so, subject to the following conditions:
-
-The above copyright notice and this permission notice shall be included in
-all copies or substantial portions of the Software.
-
-THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-THE SOFTWARE.
-*/
-
-#ifndef LOVETOKEN_LT_H
-#define LOVETOKEN_LT_H
-
-/*
- * Includes
- */
-
-#include <stdlib.h>
-
-/*
- * Definitions
- */
-
-// [marrub] This can be changed if you have either a lot of very
-//          long strings, or a lot of very small strings, for optimization.
-#define TOKEN_STR_BLOCK_LENGTH 4096
-
-// [marrub] When using in FFI, remove this from the declarations.
-//          Also make sure to redefine this if your platform is not supported.
-//          (OSX shouldn't need this at all)
-#ifndef LT_NO_EXPORT
-	#if defined(_MSC_VER)
-		#define LT_DLLEXPORT __declspec(dllexport)
-		#define LT_EXPORT
-	#elif defined(_GCC)
-		#define LT_EXPORT __attribute__((visibility("default")))
-		#define LT_DLLEXPORT
-	#else
-		#define LT_EXPORT
-		#define LT_DLLEXPORT
-	#endif
-#else
-	#define LT_EXPORT
-	#define LT_DLLEXPORT
-#endif
-
-#ifdef __GDCC__
-	#define LT_NO_ICONV
-#endif
-
-#define LT_TRUE 1
-#define LT_FALSE 0
-
-enum
-{
-	TOK_Colon,  TOK_Comma,  TOK_Div,    TOK_Mod,     TOK_Mul,
-	TOK_Query,  TOK_BraceO, TOK_BraceC, TOK_BrackO,  TOK_BrackC,
-	TOK_ParenO, TOK_ParenC, TOK_LnEnd,  TOK_Add2,    TOK_Add,
-	TOK_And2,   TOK_And,    TOK_CmpGE,  TOK_ShR,     TOK_CmpGT,
-	TOK_CmpLE,  TOK_ShL,    TOK_CmpNE,  TOK_CmpLT,   TOK_CmpEQ,
-	TOK_Equal,  TOK_Not,    TOK_OrI2,   TOK_OrI,     TOK_OrX2,
-	TOK_OrX,    TOK_Sub2,   TOK_Sub,    TOK_String,  TOK_Charac,
-	TOK_Number, TOK_Identi, TOK_EOF,    TOK_ChrSeq,  TOK_Comment,
-	TOK_Period, TOK_Arrow,  TOK_Sigil,  TOK_Hash,    TOK_BlkCmtO,
-	TOK_BlkCmtC,TOK_Exp,    TOK_NstCmtO,TOK_NstCmtC, TOK_Semicl
-};
-
-enum
-{
-	LTERR_SYNTAX,
-	LTERR_UNKNOWN_OPERATION,
-	LTERR_NOMEMORY
-};
-
-/*
- * Types
- */
-
-typedef int LT_BOOL;
-
-typedef struct
-{
-	LT_BOOL escapeChars;
-	LT_BOOL stripInvalid;
-#ifndef LT_NO_ICONV
-	LT_BOOL doConvert;
-	const char *fromCode;
-	const char *toCode;
-#endif
-	const char *stringChars;
-	const char *charChars;
-} LT_Config;
-
-typedef struct
-{
-	const char *token;
-	char *string;
-	unsigned strlen;
-	int pos;
-} LT_Token;
-
-typedef struct
-{
-	LT_BOOL failure;
-	const char *str;
-} LT_AssertInfo;
-
-typedef struct LT_GarbageList_s
-{
-	struct LT_GarbageList_s *next;
-	void *ptr;
-} LT_GarbageList; // [marrub] Don't include this into FFI declarations.
-
-/*
- * Functions
- */
-
-#ifdef __cplusplus
-extern "C"
-{
-#endif
-
-LT_DLLEXPORT void LT_EXPORT LT_Init(LT_Config initCfg);
-LT_DLLEXPORT void LT_EXPORT LT_SetConfig(LT_Config newCfg);
-LT_DLLEXPORT void LT_EXPORT LT_Quit(void);
-
-LT_DLLEXPORT LT_BOOL LT_EXPORT LT_Assert(LT_BOOL assertion, const char *fmt, ...);
-LT_DLLEXPORT void LT_EXPORT LT_Error(int type); // [marrub] C use ONLY
-LT_DLLEXPORT LT_AssertInfo LT_EXPORT LT_CheckAssert(void);
-
-#ifndef __GDCC__
-LT_DLLEXPORT LT_BOOL LT_EXPORT LT_OpenFile(const char *filePath);
-#else
-LT_DLLEXPORT LT_BOOL LT_EXPORT LT_OpenFile(__str filePath);
-#endif
-LT_DLLEXPORT void LT_EXPORT LT_SetPos(int newPos);
-LT_DLLEXPORT void LT_EXPORT LT_CloseFile(void);
-
-LT_DLLEXPORT char *LT_EXPORT LT_ReadNumber(void);
-LT_DLLEXPORT void LT_EXPORT LT_ReadString(LT_Token *tk, char term);
-LT_DLLEXPORT char *LT_EXPORT LT_Escaper(char *str, size_t pos, char escape);
-LT_DLLEXPORT LT_Token LT_EXPORT LT_GetToken(void);
-LT_DLLEXPORT char *LT_EXPORT LT_ReadLiteral(void);
-LT_DLLEXPORT void LT_EXPORT LT_SkipWhite(void);
-LT_DLLEXPORT void LT_EXPORT LT_SkipWhite2(void);
-
-#ifdef __cplusplus
-}
-#endif
-
-/*
- * Variables
- * Don't include these into FFI declarations.
- */
-
-#ifdef __cplusplus
-extern "C" const char *LT_EXPORT LT_TkNames[];
-#else
-extern const char *LT_EXPORT LT_TkNames[];
-#endif
-
-#endif
-
+/*
+Copyright (c) 2015 Benjamin Moir <bennyboy.private@hotmail.com.au>
+Copyright (c) 2015 Marrub <marrub@greyserv.net>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef LOVETOKEN_LT_H
+#define LOVETOKEN_LT_H
+
+/*
+ * Includes
+ */
+
+#include <stdlib.h>
+
+/*
+ * Definitions
+ */
+
+// [marrub] This can be changed if you have either a lot of very
+//          long strings, or a lot of very small strings, for optimization.
+#define TOKEN_STR_BLOCK_LENGTH 4096
+
+// How many of the latest errors each context keeps for LT_GetErrors. Must
+// be a power of two.
+#ifndef LT_ERROR_RING
+	#define LT_ERROR_RING 16
+#endif
+
+// Strings are allocated out of chunks of this size. Strings bigger than a
+// quarter of it get a chunk of their own.
+#ifndef LT_ARENA_CHUNK_LENGTH
+	#define LT_ARENA_CHUNK_LENGTH 65536
+#endif
+
+// [marrub] When using in FFI, remove this from the declarations.
+//          Also make sure to redefine this if your platform is not supported.
+//          (OSX shouldn't need this at all)
+#ifndef LT_NO_EXPORT
+	#if defined(_MSC_VER)
+		#define LT_DLLEXPORT __declspec(dllexport)
+		#define LT_EXPORT
+	#elif defined(_GCC)
+		#define LT_EXPORT __attribute__((visibility("default")))
+		#define LT_DLLEXPORT
+	#else
+		#define LT_EXPORT
+		#define LT_DLLEXPORT
+	#endif
+#else
+	#define LT_EXPORT
+	#define LT_DLLEXPORT
+#endif
+
+#ifdef __GDCC__
+	#define LT_NO_ICONV
+	#define LT_NO_MMAP
+	#define LT_NO_THREADS
+	#define LT_NO_TRACE
+#endif
+
+#define LT_TRUE 1
+#define LT_FALSE 0
+
+enum
+{
+	TOK_Colon,  TOK_Comma,  TOK_Div,    TOK_Mod,     TOK_Mul,
+	TOK_Query,  TOK_BraceO, TOK_BraceC, TOK_BrackO,  TOK_BrackC,
+	TOK_ParenO, TOK_ParenC, TOK_LnEnd,  TOK_Add2,    TOK_Add,
+	TOK_And2,   TOK_And,    TOK_CmpGE,  TOK_ShR,     TOK_CmpGT,
+	TOK_CmpLE,  TOK_ShL,    TOK_CmpNE,  TOK_CmpLT,   TOK_CmpEQ,
+	TOK_Equal,  TOK_Not,    TOK_OrI2,   TOK_OrI,     TOK_OrX2,
+	TOK_OrX,    TOK_Sub2,   TOK_Sub,    TOK_String,  TOK_Charac,
+	TOK_Number, TOK_Identi, TOK_EOF,    TOK_ChrSeq,  TOK_Comment,
+	TOK_Period, TOK_Arrow,  TOK_Sigil,  TOK_Hash,    TOK_BlkCmtO,
+	TOK_BlkCmtC,TOK_Exp,    TOK_NstCmtO,TOK_NstCmtC, TOK_Semicl,
+	TOK_Keywrd
+};
+
+enum
+{
+	LTERR_SYNTAX,
+	LTERR_UNKNOWN_OPERATION,
+	LTERR_NOMEMORY
+};
+
+// What a number token's numType says it is, with parseNumbers.
+enum
+{
+	LT_NUM_NONE,  // not a number, or parseNumbers is off
+	LT_NUM_INT,   // intValue holds it (and floatValue as near as it can)
+	LT_NUM_FLOAT, // floatValue holds it
+	LT_NUM_BAD    // malformed or out of range
+};
+
+/*
+ * Types
+ */
+
+typedef int LT_BOOL;
+
+typedef struct
+{
+	LT_BOOL escapeChars;
+	LT_BOOL stripInvalid;
+#ifndef LT_NO_ICONV
+	LT_BOOL doConvert; // convert whole sources from fromCode (or their BOM's encoding) to toCode
+	const char *fromCode; // default UTF-8 (copied)
+	const char *toCode; // default UTF-8 (copied)
+#endif
+	const char *stringChars;
+	const char *charChars;
+	LT_BOOL mapFiles; // map files into memory in LT_OpenFile instead of using stdio
+	LT_BOOL spanTokens; // leave token strings in the source buffer where possible
+	LT_BOOL internIdents; // give identifiers a symbol and a shared string
+	const char *const *keywords; // NULL-terminated, lexed as TOK_Keywrd + index (copied)
+	LT_BOOL parseNumbers; // read numbers as C literals and give their tokens values
+	LT_BOOL lazyEscapes; // leave strings as spans and decode escapes in LT_DecodeString
+	size_t memLimit; // most bytes a context may hold for tokens and sources, 0 for no limit
+	LT_BOOL skipComments; // read //, /* */ and /+ +/ comments whole instead of returning their openers
+	LT_BOOL commentSpans; // with skipComments, return each comment as a TOK_Comment spanning all of it
+} LT_Config;
+
+// With memLimit, a token that would go over it (or that malloc fails for)
+// isn't returned. LT_GetToken gives TOK_EOF at the token's start instead,
+// having raised LT_ERR_MEMORY, and the source is left there so the caller
+// can free strings and try again or give up. Opening or feeding a source
+// that won't fit fails the same way, and LT_TokenizeParallel returns NULL.
+// LT_ApplyEdit lexes the whole document again and fails if that still
+// runs out. Without memLimit, running out of memory is still fatal.
+// Strings, symbols, the line index and copies of sources count against
+// it; mapped files and the context itself don't.
+
+// With skipComments, comments don't come back as TOK_Comment, TOK_BlkCmtO
+// and TOK_NstCmtO followed by their contents. They're read whole (/+ +/
+// ones nest) and lexing carries on after them. With commentSpans too, each
+// is returned as one TOK_Comment, with string NULL (a copy of its text when
+// fed with LT_Feed) and spanPos/spanLen covering it from opener to closer. A line comment's '\n' isn't part of
+// it. One that's never closed raises LT_ERR_COMMENT.
+
+// spanPos/spanLen are the raw bytes of the token's text in the source,
+// or -1/0 if it has none. With spanTokens enabled and a memory source,
+// string is NULL unless the text had to be changed (escapes).
+// Use LT_GetSpan or LT_TokenString to get at it.
+// With doConvert, the source is converted before it's lexed, so positions
+// and spans are in the converted text.
+// Interned identifiers' and keywords' strings are shared and must not be
+// modified. A keyword's token is the keyword itself.
+// With parseNumbers, numbers read from a buffer only get a span too, and
+// their values are already in the token. Numbers take a sign after their
+// exponent's e (p in hex) like in C, so "1e-5" is one token.
+// With lazyEscapes and a buffer source, strings are spans as well. If their
+// text has escapes, hasEscapes is set and strlen is the raw length until
+// LT_DecodeString (or LT_TokenString) decodes them.
+// line and col are where pos is, both from 1, with col counted in bytes.
+// LT_OffsetToLineCol finds them for any other offset already read.
+typedef struct
+{
+	const char *token;
+	char *string;
+	unsigned strlen;
+	int pos;
+	int spanPos;
+	unsigned spanLen;
+	int kind; // TOK_*, token is LT_TkNames[kind] below TOK_Keywrd
+	int symbol; // with internIdents, identifiers' symbol ID (from 1), else 0
+	int numType; // with parseNumbers, numbers' LT_NUM_*, else LT_NUM_NONE
+	unsigned suffixLen; // length of a number's suffix, like "u" or "f", at the end of its text
+	unsigned long long intValue;
+	double floatValue;
+	LT_BOOL hasEscapes; // a string's text has escape sequences in it
+	int line, col;
+} LT_Token;
+
+// The newest error, if there's been one since errors were last cleared.
+// str is made by LT_CheckAssert and lasts until it's called again.
+typedef struct
+{
+	LT_BOOL failure;
+	const char *str;
+} LT_AssertInfo;
+
+// What an LT_ErrorInfo is about.
+enum
+{
+	LT_ERR_NONE,
+	LT_ERR_ASSERT,       // raised with LT_Assert, detail is its message
+	LT_ERR_SYSTEM,       // arg is errno
+	LT_ERR_ICONV,        // detail is the encoding, if it's known
+	LT_ERR_NULL_DATA,
+	LT_ERR_STREAM_SEEK,
+	LT_ERR_POSITION,     // arg is the position
+	LT_ERR_ESCAPE,       // arg is the character, offset is its backslash
+	LT_ERR_UNTERMINATED,
+	LT_ERR_KEYWORDS,
+	LT_ERR_NOT_BUFFER,
+	LT_ERR_NO_TRACE,
+	LT_ERR_EDIT_RANGE,
+	LT_ERR_NULL_INSERT,
+	LT_ERR_MEMORY,       // arg is the bytes asked for
+	LT_ERR_COMMENT,
+	LT_ERR_MAX
+};
+
+// An error as it was raised. Nothing is formatted until LT_FormatError (or
+// LT_CheckAssert) is asked for the text, and line and col are only worked
+// out by LT_GetErrors (or when the source is closed). func is a string
+// constant, and an LT_Assert message in detail is only kept until the next
+// LT_Assert.
+typedef struct
+{
+	int code; // LT_ERR_*
+	const char *func; // what raised it, or NULL for LT_Assert
+	long offset; // in the source, or -1 if there wasn't one
+	int line, col; // where offset is, or 0 if it isn't known
+	long arg;
+	const char *detail;
+} LT_ErrorInfo;
+
+// Counters kept by each context since it was created or LT_ResetStats.
+// Compiling with LT_NO_STATS removes them, and LT_GetStats returns zeroes.
+typedef struct
+{
+	size_t tokens[TOK_Keywrd + 1]; // LT_GetToken results by kind, keywords all count as TOK_Keywrd
+	size_t bytes;       // source bytes taken up by those tokens
+	size_t allocs;      // heap allocations and reallocations
+	size_t allocBytes;  // bytes asked for by those
+	size_t conversions; // sources (or pieces of streams) converted with iconv
+	size_t strGrowths;  // strings grown past their first TOKEN_STR_BLOCK_LENGTH or so
+	size_t asserts;     // assertions raised
+} LT_Stats;
+
+// Holds all of the state for one tokenizer. Every context is independent, so
+// separate threads may each use their own context at the same time.
+// The plain (non-Ctx) functions operate on a single default context.
+typedef struct LT_Context_s LT_Context;
+
+// A copy of some text and its tokens, kept up to date through LT_ApplyEdit
+// by re-lexing only around each edit. Documents have their own context.
+// With doConvert, the text is converted when the document is created and
+// kept converted: LT_DocumentText gives the converted text, edits' offsets
+// and inserted bytes are in it, and the context has doConvert turned off.
+typedef struct LT_Document_s LT_Document;
+
+// Token caches save re-lexing sources that haven't changed. LT_SaveTokens
+// writes the tokens of a memory or mapped source (all of them, as from
+// LT_TokenizeParallel) to a file, keyed by a hash of the source and of the
+// config. LT_LoadTokens maps that file in and, if it still matches, hands
+// the tokens back without lexing, leaving the source at its end. Otherwise
+// it returns NULL. Caches are only read back by the same version of LT on
+// the same kind of machine, and anything else (including a damaged file) is
+// just a miss.
+
+/*
+ * Functions
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+LT_DLLEXPORT void LT_EXPORT LT_Init(LT_Config initCfg);
+LT_DLLEXPORT void LT_EXPORT LT_SetConfig(LT_Config newCfg);
+LT_DLLEXPORT void LT_EXPORT LT_Quit(void);
+LT_DLLEXPORT void LT_EXPORT LT_ReleaseStrings(void);
+
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_Assert(LT_BOOL assertion, const char *fmt, ...);
+LT_DLLEXPORT void LT_EXPORT LT_Error(int type); // [marrub] C use ONLY
+LT_DLLEXPORT LT_AssertInfo LT_EXPORT LT_CheckAssert(void);
+LT_DLLEXPORT size_t LT_EXPORT LT_GetErrors(LT_ErrorInfo *out, size_t max);
+LT_DLLEXPORT void LT_EXPORT LT_ClearErrors(void);
+LT_DLLEXPORT size_t LT_EXPORT LT_FormatError(const LT_ErrorInfo *err, char *buf, size_t size);
+
+#ifndef __GDCC__
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_OpenFile(const char *filePath);
+#else
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_OpenFile(__str filePath);
+#endif
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_OpenMemory(const char *data, size_t size);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_Feed(const char *data, size_t len, LT_BOOL isLast);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_NeedsInput(void);
+LT_DLLEXPORT void LT_EXPORT LT_SetPos(int newPos);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_OffsetToLineCol(long offset, int *line, int *col);
+LT_DLLEXPORT void LT_EXPORT LT_CloseFile(void);
+
+LT_DLLEXPORT char *LT_EXPORT LT_ReadNumber(void);
+LT_DLLEXPORT void LT_EXPORT LT_ReadString(LT_Token *tk, char term);
+LT_DLLEXPORT char *LT_EXPORT LT_Escaper(char *str, size_t pos, char escape);
+LT_DLLEXPORT LT_Token LT_EXPORT LT_GetToken(void);
+LT_DLLEXPORT size_t LT_EXPORT LT_GetTokens(LT_Token *out, size_t max);
+LT_DLLEXPORT LT_Token *LT_EXPORT LT_TokenizeParallel(unsigned threads, size_t *count);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_SaveTokens(const char *cachePath, const LT_Token *tokens, size_t count);
+LT_DLLEXPORT LT_Token *LT_EXPORT LT_LoadTokens(const char *cachePath, size_t *count);
+LT_DLLEXPORT char *LT_EXPORT LT_ReadLiteral(void);
+LT_DLLEXPORT void LT_EXPORT LT_SkipWhite(void);
+LT_DLLEXPORT void LT_EXPORT LT_SkipWhite2(void);
+LT_DLLEXPORT const char *LT_EXPORT LT_GetSpan(const LT_Token *tk);
+LT_DLLEXPORT char *LT_EXPORT LT_TokenString(LT_Token *tk);
+LT_DLLEXPORT char *LT_EXPORT LT_DecodeString(LT_Token *tk);
+LT_DLLEXPORT int LT_EXPORT LT_Intern(const char *str);
+LT_DLLEXPORT const char *LT_EXPORT LT_SymbolName(int symbol);
+LT_DLLEXPORT LT_Stats LT_EXPORT LT_GetStats(void);
+LT_DLLEXPORT void LT_EXPORT LT_ResetStats(void);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_StartTrace(size_t maxEvents);
+LT_DLLEXPORT void LT_EXPORT LT_StopTrace(void);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_DumpTrace(const char *filePath);
+
+LT_DLLEXPORT LT_Context *LT_EXPORT LT_CreateContext(LT_Config initCfg);
+LT_DLLEXPORT void LT_EXPORT LT_SetConfigCtx(LT_Context *ctx, LT_Config newCfg);
+LT_DLLEXPORT void LT_EXPORT LT_DestroyContext(LT_Context *ctx);
+LT_DLLEXPORT void LT_EXPORT LT_ReleaseStringsCtx(LT_Context *ctx);
+
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_AssertCtx(LT_Context *ctx, LT_BOOL assertion, const char *fmt, ...);
+LT_DLLEXPORT LT_AssertInfo LT_EXPORT LT_CheckAssertCtx(LT_Context *ctx);
+LT_DLLEXPORT size_t LT_EXPORT LT_GetErrorsCtx(LT_Context *ctx, LT_ErrorInfo *out, size_t max);
+LT_DLLEXPORT void LT_EXPORT LT_ClearErrorsCtx(LT_Context *ctx);
+
+#ifndef __GDCC__
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_OpenFileCtx(LT_Context *ctx, const char *filePath);
+#else
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_OpenFileCtx(LT_Context *ctx, __str filePath);
+#endif
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_OpenMemoryCtx(LT_Context *ctx, const char *data, size_t size);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_FeedCtx(LT_Context *ctx, const char *data, size_t len, LT_BOOL isLast);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_NeedsInputCtx(LT_Context *ctx);
+LT_DLLEXPORT void LT_EXPORT LT_SetPosCtx(LT_Context *ctx, int newPos);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_OffsetToLineColCtx(LT_Context *ctx, long offset, int *line, int *col);
+LT_DLLEXPORT void LT_EXPORT LT_CloseFileCtx(LT_Context *ctx);
+
+LT_DLLEXPORT char *LT_EXPORT LT_ReadNumberCtx(LT_Context *ctx);
+LT_DLLEXPORT void LT_EXPORT LT_ReadStringCtx(LT_Context *ctx, LT_Token *tk, char term);
+LT_DLLEXPORT char *LT_EXPORT LT_EscaperCtx(LT_Context *ctx, char *str, size_t pos, char escape);
+LT_DLLEXPORT LT_Token LT_EXPORT LT_GetTokenCtx(LT_Context *ctx);
+LT_DLLEXPORT size_t LT_EXPORT LT_GetTokensCtx(LT_Context *ctx, LT_Token *out, size_t max);
+LT_DLLEXPORT LT_Token *LT_EXPORT LT_TokenizeParallelCtx(LT_Context *ctx, unsigned threads, size_t *count);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_SaveTokensCtx(LT_Context *ctx, const char *cachePath, const LT_Token *tokens, size_t count);
+LT_DLLEXPORT LT_Token *LT_EXPORT LT_LoadTokensCtx(LT_Context *ctx, const char *cachePath, size_t *count);
+LT_DLLEXPORT char *LT_EXPORT LT_ReadLiteralCtx(LT_Context *ctx);
+LT_DLLEXPORT void LT_EXPORT LT_SkipWhiteCtx(LT_Context *ctx);
+LT_DLLEXPORT void LT_EXPORT LT_SkipWhite2Ctx(LT_Context *ctx);
+LT_DLLEXPORT const char *LT_EXPORT LT_GetSpanCtx(LT_Context *ctx, const LT_Token *tk);
+LT_DLLEXPORT char *LT_EXPORT LT_TokenStringCtx(LT_Context *ctx, LT_Token *tk);
+LT_DLLEXPORT char *LT_EXPORT LT_DecodeStringCtx(LT_Context *ctx, LT_Token *tk);
+LT_DLLEXPORT int LT_EXPORT LT_InternCtx(LT_Context *ctx, const char *str);
+LT_DLLEXPORT const char *LT_EXPORT LT_SymbolNameCtx(LT_Context *ctx, int symbol);
+LT_DLLEXPORT LT_Stats LT_EXPORT LT_GetStatsCtx(LT_Context *ctx);
+LT_DLLEXPORT void LT_EXPORT LT_ResetStatsCtx(LT_Context *ctx);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_StartTraceCtx(LT_Context *ctx, size_t maxEvents);
+LT_DLLEXPORT void LT_EXPORT LT_StopTraceCtx(LT_Context *ctx);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_DumpTraceCtx(LT_Context *ctx, const char *filePath);
+
+LT_DLLEXPORT LT_Document *LT_EXPORT LT_CreateDocument(LT_Config cfg, const char *text, size_t len);
+LT_DLLEXPORT void LT_EXPORT LT_DestroyDocument(LT_Document *doc);
+LT_DLLEXPORT LT_BOOL LT_EXPORT LT_ApplyEdit(LT_Document *doc, size_t offset, size_t removed, const char *inserted, size_t insertedLen);
+LT_DLLEXPORT const LT_Token *LT_EXPORT LT_DocumentTokens(LT_Document *doc, size_t *count);
+LT_DLLEXPORT const char *LT_EXPORT LT_DocumentText(LT_Document *doc, size_t *len);
+LT_DLLEXPORT LT_Context *LT_EXPORT LT_DocumentContext(LT_Document *doc);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*
+ * Variables
+ * Don't include these into FFI declarations.
+ */
+
+#ifdef __cplusplus
+extern "C" const char *LT_EXPORT LT_TkNames[];
+#else
+extern const char *LT_EXPORT LT_TkNames[];
+#endif
+
+#endif
+
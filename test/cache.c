@@ -0,0 +1,305 @@
+// Checks that tokens saved with LT_SaveTokens load back the same under
+// several configs, and that a cache made from another source or config, or
+// one that's been cut short or damaged, is a miss. Takes a directory to
+// write its files into.
+
+#include "lt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SOURCE_LEN (1 << 16)
+#define MAX_CACHE (1 << 20)
+#define DAMAGES 200
+
+static unsigned rngState = 2463534242u;
+
+static unsigned Random(unsigned n)
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState % n;
+}
+
+static const char *dir = ".";
+
+static const char *keywords[] = { "if", "while", "return", "int", NULL };
+
+/*
+ * Sources
+ */
+
+// A bit of everything a token can carry: symbols, keywords, number values,
+// strings with escapes (some with NULs in them) and both kinds of comment.
+static size_t MakeSource(char *out, size_t max)
+{
+	static const char *const pieces[] = {
+		"if", "while", "return", "int", "(", ")", "+=", ";\n", "\n\t", "0x1F", "2.5e3f", "10u", "08",
+		"\"plain\"", "\"a\\tb\\n\"", "\"nul\\0in\"", "'\\x41'", "// line comment\n", "/* block\ncomment */"
+	};
+	size_t len = 0;
+	
+	while(len + 32 < max)
+	{
+		if(Random(3) == 0)
+		{
+			len += (size_t)sprintf(out + len, "name%u ", Random(500));
+		}
+		else
+		{
+			len += (size_t)sprintf(out + len, "%s ", pieces[Random(sizeof(pieces) / sizeof(pieces[0]))]);
+		}
+	}
+	
+	return len;
+}
+
+#define PATH_LEN 1024
+
+static const char *PathTo(char *path, const char *name)
+{
+	snprintf(path, PATH_LEN, "%s/%s", dir, name);
+	return path;
+}
+
+static size_t ReadFile(const char *path, char *out, size_t max)
+{
+	FILE *fp = fopen(path, "rb");
+	size_t len;
+	
+	if(fp == NULL)
+	{
+		return 0;
+	}
+	
+	len = fread(out, 1, max, fp);
+	fclose(fp);
+	return len;
+}
+
+static int WriteFile(const char *path, const char *data, size_t len)
+{
+	FILE *fp = fopen(path, "wb");
+	
+	if(fp == NULL)
+	{
+		return 0;
+	}
+	
+	fwrite(data, 1, len, fp);
+	return fclose(fp) == 0;
+}
+
+/*
+ * Checking
+ */
+
+// Symbols are compared by name, since the loading context numbers its own.
+// Strings are taken from copies, since taking them can fill tokens in.
+static int SameToken(LT_Context *ctxA, const LT_Token *a, LT_Context *ctxB, const LT_Token *b)
+{
+	LT_Token copyA = *a, copyB = *b;
+	const char *textA, *textB;
+	
+	if(a->kind != b->kind || a->pos != b->pos || a->line != b->line || a->col != b->col || a->spanPos != b->spanPos ||
+		a->spanLen != b->spanLen || a->strlen != b->strlen || a->hasEscapes != b->hasEscapes ||
+		a->numType != b->numType || a->intValue != b->intValue || a->floatValue != b->floatValue ||
+		a->suffixLen != b->suffixLen || (a->symbol == 0) != (b->symbol == 0) || strcmp(a->token, b->token) != 0)
+	{
+		return 0;
+	}
+	
+	if(a->symbol != 0 && strcmp(LT_SymbolNameCtx(ctxA, a->symbol), LT_SymbolNameCtx(ctxB, b->symbol)) != 0)
+	{
+		return 0;
+	}
+	
+	textA = LT_TokenStringCtx(ctxA, &copyA);
+	textB = LT_TokenStringCtx(ctxB, &copyB);
+	
+	return copyA.strlen == copyB.strlen && (textA == NULL) == (textB == NULL) &&
+		(textA == NULL || memcmp(textA, textB, copyA.strlen) == 0);
+}
+
+static int SameTokens(LT_Context *ctxA, const LT_Token *a, size_t countA, LT_Context *ctxB, const LT_Token *b,
+	size_t countB)
+{
+	size_t i;
+	
+	if(countA != countB)
+	{
+		return 0;
+	}
+	
+	for(i = 0; i < countA; i++)
+	{
+		if(!SameToken(ctxA, &a[i], ctxB, &b[i]))
+		{
+			printf("token %lu at %d differs\n", (unsigned long)i, a[i].pos);
+			return 0;
+		}
+	}
+	
+	return 1;
+}
+
+// The newest error's code, or LT_ERR_NONE.
+static int LastError(LT_Context *ctx)
+{
+	LT_ErrorInfo err;
+	
+	return LT_GetErrorsCtx(ctx, &err, 1) != 0 ? err.code : LT_ERR_NONE;
+}
+
+// A miss returns NULL and a count of 0, and raises nothing.
+static int Misses(LT_Context *ctx, const char *path)
+{
+	size_t count = 1;
+	
+	return LT_LoadTokensCtx(ctx, path, &count) == NULL && count == 0 && LastError(ctx) == LT_ERR_NONE;
+}
+
+// A damaged cache may only load if what it loads is still right, such as
+// when the damage is in the header's padding.
+static unsigned CheckDamaged(LT_Context *want, const LT_Token *tokens, size_t count, LT_Config cfg,
+	const char *src, size_t srcLen, const char *cache, size_t cacheLen)
+{
+	static char damaged[MAX_CACHE];
+	char path[PATH_LEN];
+	unsigned failures = 0, i;
+	
+	PathTo(path, "damaged.cache");
+	
+	for(i = 0; i < DAMAGES; i++)
+	{
+		LT_Context *ctx = LT_CreateContext(cfg);
+		size_t len = cacheLen, have;
+		LT_Token *loaded;
+		
+		memcpy(damaged, cache, cacheLen);
+		
+		// Cut short, or with a bit flipped, often in the header.
+		if(i % 2 == 0)
+		{
+			len = i / 2 < 64 ? i / 2 : Random((unsigned)cacheLen);
+		}
+		else
+		{
+			size_t at = i / 2 < 64 ? i / 2 : Random((unsigned)cacheLen);
+			
+			damaged[at] ^= (char)(1 << Random(8));
+		}
+		
+		WriteFile(path, damaged, len);
+		LT_OpenMemoryCtx(ctx, src, srcLen);
+		loaded = LT_LoadTokensCtx(ctx, path, &have);
+		
+		if(LastError(ctx) != LT_ERR_NONE || (loaded == NULL ? have != 0 : !SameTokens(want, tokens, count, ctx, loaded, have)))
+		{
+			failures++;
+			printf("damage %u loaded %lu tokens\n", i, (unsigned long)have);
+		}
+		
+		LT_DestroyContext(ctx);
+	}
+	
+	remove(path);
+	return failures;
+}
+
+static int Run(const char *name, LT_Config cfg, char *src, size_t len)
+{
+	static char cache[MAX_CACHE];
+	char path[PATH_LEN], missing[PATH_LEN];
+	LT_Context *saver = LT_CreateContext(cfg), *loader = LT_CreateContext(cfg), *other;
+	LT_Token *tokens, *loaded;
+	size_t count, have, cacheLen;
+	unsigned failures = 0;
+	LT_Config otherCfg = cfg;
+	
+	PathTo(path, "tokens.cache");
+	remove(path);
+	LT_OpenMemoryCtx(saver, src, len);
+	tokens = LT_TokenizeParallelCtx(saver, 1, &count);
+	
+	if(tokens == NULL || !LT_SaveTokensCtx(saver, path, tokens, count))
+	{
+		printf("can't save %s\n", path);
+		return 1;
+	}
+	
+	// The loader has a symbol of its own first, so its IDs are different.
+	LT_InternCtx(loader, "unrelated");
+	LT_OpenMemoryCtx(loader, src, len);
+	failures += !Misses(loader, PathTo(missing, "missing.cache"));
+	
+	loaded = LT_LoadTokensCtx(loader, path, &have);
+	failures += loaded == NULL || !SameTokens(saver, tokens, count, loader, loaded, have);
+	
+	// The source is left at its end.
+	failures += LT_GetTokenCtx(loader).kind != TOK_EOF;
+	
+	// Another config or a changed source is a miss.
+	otherCfg.escapeChars = !cfg.escapeChars;
+	other = LT_CreateContext(otherCfg);
+	LT_OpenMemoryCtx(other, src, len);
+	failures += !Misses(other, path);
+	LT_DestroyContext(other);
+	
+	other = LT_CreateContext(cfg);
+	src[len / 2] ^= 1;
+	LT_OpenMemoryCtx(other, src, len);
+	failures += !Misses(other, path);
+	src[len / 2] ^= 1;
+	LT_OpenMemoryCtx(other, src, len - 1);
+	failures += !Misses(other, path);
+	LT_DestroyContext(other);
+	
+	cacheLen = ReadFile(path, cache, sizeof(cache));
+	failures += cacheLen == 0 || cacheLen == sizeof(cache);
+	failures += CheckDamaged(saver, tokens, count, cfg, src, len, cache, cacheLen);
+	
+	remove(path);
+	LT_DestroyContext(saver);
+	LT_DestroyContext(loader);
+	
+	printf("%s\t%lu tokens, %lu byte cache, %u wrong\n", name, (unsigned long)count, (unsigned long)cacheLen, failures);
+	return failures != 0;
+}
+
+int main(int argc, char **argv)
+{
+	static char src[SOURCE_LEN];
+	size_t len = MakeSource(src, sizeof(src));
+	LT_Config cfg;
+	int failed = 0;
+	
+	if(argc > 1)
+	{
+		dir = argv[1];
+	}
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.escapeChars = LT_TRUE;
+	failed |= Run("plain", cfg, src, len);
+	
+	cfg.internIdents = LT_TRUE;
+	cfg.keywords = keywords;
+	failed |= Run("interned", cfg, src, len);
+	
+	cfg.spanTokens = LT_TRUE;
+	cfg.parseNumbers = LT_TRUE;
+	cfg.lazyEscapes = LT_TRUE;
+	failed |= Run("spans", cfg, src, len);
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.escapeChars = LT_TRUE;
+	cfg.skipComments = LT_TRUE;
+	cfg.commentSpans = LT_TRUE;
+	cfg.parseNumbers = LT_TRUE;
+	failed |= Run("comments", cfg, src, len);
+	
+	return failed;
+}
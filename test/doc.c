@@ -0,0 +1,240 @@
+// Checks that documents edited with LT_ApplyEdit have the same tokens as a
+// new document made from their text, under a few configs, with random edits.
+
+#include "lt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EDITS 500
+
+static unsigned rngState = 2463534242u;
+
+static unsigned Random(unsigned n)
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState % n;
+}
+
+/*
+ * Sources
+ */
+
+static const char *const pieces[] = {
+	"ident", " ", "\n", "123", "0x1F", "1.5e3", "\"str\"", "\"esc\\n\"", "'c'", "/*", "*/", "//",
+	"/+", "+/", "+", "==", "(", ")", ";", "\"", "\\", "\t", "\xC3\xA9",
+};
+
+#define NUM_PIECES (sizeof(pieces) / sizeof(pieces[0]))
+
+static size_t MakeSource(char *out, size_t max)
+{
+	size_t len = 0;
+	
+	while(len + 16 < max)
+	{
+		const char *piece = pieces[Random(NUM_PIECES)];
+		
+		memcpy(out + len, piece, strlen(piece));
+		len += strlen(piece);
+	}
+	
+	return len;
+}
+
+#ifndef LT_NO_ICONV
+// Turns UTF-8 made only of ASCII and U+00E9 into UTF-16LE with a BOM.
+static size_t ToUTF16(char *out, const char *src, size_t len)
+{
+	size_t n = 0, i;
+	
+	out[n++] = (char)0xFF;
+	out[n++] = (char)0xFE;
+	
+	for(i = 0; i < len; i++)
+	{
+		if((unsigned char)src[i] == 0xC3)
+		{
+			out[n++] = (char)(((src[i] & 0x1F) << 6) | (src[i + 1] & 0x3F));
+			i++;
+			out[n++] = 0;
+			continue;
+		}
+		
+		out[n++] = src[i];
+		out[n++] = 0;
+	}
+	
+	return n;
+}
+#endif
+
+/*
+ * Checking
+ */
+
+static int SameToken(const LT_Token *a, const LT_Token *b)
+{
+	if(a->kind != b->kind || a->pos != b->pos || a->line != b->line || a->col != b->col ||
+		a->spanPos != b->spanPos || a->spanLen != b->spanLen || a->strlen != b->strlen ||
+		a->hasEscapes != b->hasEscapes || (a->string == NULL) != (b->string == NULL))
+	{
+		return 0;
+	}
+	
+	return a->string == NULL || memcmp(a->string, b->string, a->strlen) == 0;
+}
+
+// Looks up some offsets' lines in both, which the edited document has
+// patched its line index for.
+static int SameLines(LT_Document *doc, LT_Document *fresh, size_t len)
+{
+	int i;
+	
+	for(i = 0; i < 8; i++)
+	{
+		long offset = (long)Random((unsigned)len + 1);
+		int haveLine = 0, haveCol = 0, wantLine = 0, wantCol = 0;
+		
+		if(LT_OffsetToLineColCtx(LT_DocumentContext(doc), offset, &haveLine, &haveCol) !=
+			LT_OffsetToLineColCtx(LT_DocumentContext(fresh), offset, &wantLine, &wantCol) ||
+			haveLine != wantLine || haveCol != wantCol)
+		{
+			return 0;
+		}
+	}
+	
+	return 1;
+}
+
+// Returns the index of the first token that differs, -2 if a line does,
+// or -1.
+static long Compare(LT_Document *doc, LT_Config cfg)
+{
+	const LT_Token *have, *want;
+	size_t haveCount, wantCount, len, i;
+	const char *text = LT_DocumentText(doc, &len);
+	LT_Document *fresh;
+	long bad = -1;
+	
+	// The document's text is already converted.
+#ifndef LT_NO_ICONV
+	cfg.doConvert = LT_FALSE;
+#endif
+	fresh = LT_CreateDocument(cfg, text, len);
+	
+	have = LT_DocumentTokens(doc, &haveCount);
+	want = LT_DocumentTokens(fresh, &wantCount);
+	
+	for(i = 0; i < haveCount && i < wantCount; i++)
+	{
+		if(!SameToken(&have[i], &want[i]))
+		{
+			bad = (long)i;
+			break;
+		}
+	}
+	
+	if(bad < 0 && haveCount != wantCount)
+	{
+		bad = (long)(haveCount < wantCount ? haveCount : wantCount);
+	}
+	
+	if(bad < 0 && !SameLines(doc, fresh, len))
+	{
+		bad = -2;
+	}
+	
+	LT_DestroyDocument(fresh);
+	return bad;
+}
+
+static int Run(const char *name, LT_Config cfg, const char *src, size_t len)
+{
+	static const char *const inserts[] = { "", "a", " ", "\n", "\"", "/*", "*/", "\\", "12", "\xC3\xA9", "\xC3", "\xA9" };
+	LT_Document *doc = LT_CreateDocument(cfg, src, len);
+	unsigned edit, failures = 0;
+	
+	for(edit = 0; edit < EDITS; edit++)
+	{
+		const char *insert = inserts[Random(sizeof(inserts) / sizeof(inserts[0]))];
+		size_t docLen, offset, removed;
+		long bad;
+		
+		LT_DocumentText(doc, &docLen);
+		offset = Random((unsigned)docLen + 1);
+		removed = Random(4);
+		
+		if(removed > docLen - offset)
+		{
+			removed = docLen - offset;
+		}
+		
+		LT_ApplyEdit(doc, offset, removed, insert, strlen(insert));
+		
+		if((bad = Compare(doc, cfg)) != -1)
+		{
+			if(failures++ == 0 && bad == -2)
+			{
+				printf("%s: edit %u (offset %lu, removed %lu) has a different line index\n", name, edit,
+					(unsigned long)offset, (unsigned long)removed);
+			}
+			else if(failures == 1)
+			{
+				printf("%s: edit %u (offset %lu, removed %lu) differs at token %ld\n", name, edit,
+					(unsigned long)offset, (unsigned long)removed, bad);
+			}
+		}
+	}
+	
+	LT_DestroyDocument(doc);
+	
+	printf("%s\t%u/%u edits differ\n", name, failures, EDITS);
+	return failures != 0;
+}
+
+int main(void)
+{
+	static char src[1 << 14];
+	size_t len = MakeSource(src, sizeof(src));
+	LT_Config cfg;
+	int failed = 0;
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.escapeChars = LT_TRUE;
+	failed |= Run("plain", cfg, src, len);
+	
+	cfg.spanTokens = LT_TRUE;
+	cfg.parseNumbers = LT_TRUE;
+	failed |= Run("spans", cfg, src, len);
+	
+	cfg.skipComments = LT_TRUE;
+	cfg.commentSpans = LT_TRUE;
+	failed |= Run("comments", cfg, src, len);
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.escapeChars = LT_TRUE;
+	cfg.stripInvalid = LT_TRUE;
+	failed |= Run("strip", cfg, src, len);
+	
+#ifndef LT_NO_ICONV
+	{
+		static char wide[2 << 14], bom[(1 << 14) + 3];
+		size_t wideLen = ToUTF16(wide, src, len);
+		
+		memcpy(bom, "\xEF\xBB\xBF", 3);
+		memcpy(bom + 3, src, len);
+		
+		memset(&cfg, 0, sizeof(cfg));
+		cfg.escapeChars = LT_TRUE;
+		cfg.doConvert = LT_TRUE;
+		failed |= Run("utf8-bom", cfg, bom, len + 3);
+		failed |= Run("utf16-bom", cfg, wide, wideLen);
+	}
+#endif
+	
+	return failed;
+}
@@ -0,0 +1,186 @@
+// Checks the text strings decode to and the errors bad escapes raise, decoded
+// as they're read, lazily from spans and fed a byte at a time.
+
+#include "lt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ERRORS 64
+
+typedef struct
+{
+	const char *text;
+	const char *decoded;
+	unsigned decodedLen;
+	int bad; // the unknown escape character, or 0
+	int badAt; // where its backslash is in text
+} EscapeCase;
+
+static const EscapeCase cases[] = {
+	{ "\"plain\"",              "plain",    5, 0,   0 },
+	{ "\"a\\nb\"",              "a\nb",     3, 0,   0 },
+	{ "\"\\t\\\\\\\"\"",        "\t\\\"",   3, 0,   0 },
+	{ "\"\\x41\\x4a!\"",        "AJ!",      3, 0,   0 },
+	{ "\"\\101\\0\\7\"",        "A\0\a",    3, 0,   0 },
+	{ "\"\\1234\"",             "S4",       2, 0,   0 },
+	{ "\"ok\\x\"",              "ok\0",     3, 0,   0 },
+	{ "\"x\\qy\"",              "xqy",      3, 'q', 2 },
+	{ "\"\\zz\"",               "zz",       2, 'z', 1 },
+	{ "\"a\\n\\w\"",            "a\nw",     3, 'w', 4 },
+	{ "'\\w'",                  "w",        1, 'w', 1 },
+};
+
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+
+// Each case is on its own line, indented and followed by an identifier.
+#define INDENT 2
+
+/*
+ * Sources
+ */
+
+static size_t MakeSource(char *out, long *lineStarts)
+{
+	size_t len = 0, i;
+	
+	for(i = 0; i < NUM_CASES; i++)
+	{
+		lineStarts[i] = (long)len;
+		len += (size_t)sprintf(out + len, "%*s%s x;\n", INDENT, "", cases[i].text);
+	}
+	
+	return len;
+}
+
+/*
+ * Checking
+ */
+
+// Reads every token, fed a byte at a time if feed is set, and returns how
+// many strings decoded wrong.
+static unsigned Lex(LT_Context *ctx, const char *src, size_t len, LT_BOOL feed)
+{
+	unsigned failures = 0;
+	size_t fed = 0, i = 0;
+	LT_Token tk;
+	
+	if(feed)
+	{
+		LT_CloseFileCtx(ctx);
+		LT_FeedCtx(ctx, src, 1, len == 1);
+		fed = 1;
+	}
+	else
+	{
+		LT_OpenMemoryCtx(ctx, src, len);
+	}
+	
+	for(;;)
+	{
+		const char *str;
+		
+		tk = LT_GetTokenCtx(ctx);
+		
+		if(tk.kind == TOK_EOF && feed && LT_NeedsInputCtx(ctx))
+		{
+			LT_FeedCtx(ctx, src + fed, 1, fed + 1 == len);
+			fed++;
+			continue;
+		}
+		
+		if(tk.kind == TOK_EOF)
+		{
+			break;
+		}
+		
+		if(tk.kind != TOK_String && tk.kind != TOK_Charac)
+		{
+			continue;
+		}
+		
+		str = LT_TokenStringCtx(ctx, &tk);
+		
+		if(i >= NUM_CASES || str == NULL || tk.strlen != cases[i].decodedLen ||
+			memcmp(str, cases[i].decoded, cases[i].decodedLen) != 0 || str[tk.strlen] != '\0')
+		{
+			failures++;
+			printf("string %lu at %d decoded wrong\n", (unsigned long)i, tk.pos);
+		}
+		
+		i++;
+	}
+	
+	return failures + (i != NUM_CASES);
+}
+
+// The errors have to be the bad escapes, in order, at their backslashes.
+static unsigned CheckErrors(LT_Context *ctx, const long *lineStarts)
+{
+	LT_ErrorInfo errs[MAX_ERRORS];
+	size_t count = LT_GetErrorsCtx(ctx, errs, MAX_ERRORS), n = 0, i;
+	unsigned failures = 0;
+	
+	for(i = 0; i < NUM_CASES; i++)
+	{
+		long offset = lineStarts[i] + INDENT + cases[i].badAt;
+		
+		if(cases[i].bad == 0)
+		{
+			continue;
+		}
+		
+		if(n >= count || errs[n].code != LT_ERR_ESCAPE || errs[n].arg != cases[i].bad || errs[n].offset != offset ||
+			errs[n].line != (int)i + 1 || errs[n].col != INDENT + cases[i].badAt + 1)
+		{
+			failures++;
+			
+			if(n < count)
+			{
+				printf("error %lu is code %d, '%c' at %ld (line %d, col %d), not '%c' at %ld\n", (unsigned long)n,
+					errs[n].code, (int)errs[n].arg, errs[n].offset, errs[n].line, errs[n].col, cases[i].bad, offset);
+			}
+		}
+		
+		n++;
+	}
+	
+	return failures + (count != n);
+}
+
+static int Run(const char *name, LT_Config cfg, LT_BOOL feed)
+{
+	static char src[1024];
+	long lineStarts[NUM_CASES];
+	size_t len = MakeSource(src, lineStarts);
+	LT_Context *ctx = LT_CreateContext(cfg);
+	unsigned failures;
+	
+	failures = Lex(ctx, src, len, feed);
+	failures += CheckErrors(ctx, lineStarts);
+	
+	LT_DestroyContext(ctx);
+	
+	printf("%s\t%u wrong\n", name, failures);
+	return failures != 0;
+}
+
+int main(void)
+{
+	LT_Config cfg;
+	int failed = 0;
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.escapeChars = LT_TRUE;
+	failed |= Run("eager", cfg, LT_FALSE);
+	failed |= Run("fed", cfg, LT_TRUE);
+	
+	// Lazy errors are raised as each string is decoded, but still point at
+	// the string.
+	cfg.spanTokens = LT_TRUE;
+	cfg.lazyEscapes = LT_TRUE;
+	failed |= Run("lazy", cfg, LT_FALSE);
+	
+	return failed;
+}
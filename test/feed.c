@@ -0,0 +1,219 @@
+// Checks that a source fed in random pieces with LT_Feed gives the same
+// tokens and errors as the whole of it opened with LT_OpenMemory.
+
+#include "lt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SOURCE_LEN (1 << 16)
+#define MAX_PIECE 37
+#define MAX_ERRORS 64
+
+static unsigned rngState = 2463534242u;
+
+static unsigned Random(unsigned n)
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState % n;
+}
+
+/*
+ * Sources
+ */
+
+static const char *const pieces[] = {
+	"ident", "if", "while", " ", "\n", "123", "0x1Fu", "1.5e-3f", "\"str\"", "\"esc\\n\"", "\"bad\\q\"", "'c'",
+	"\"two\nlines\"", "/* a\n\"b\n*/", "// line\n", "/+ /+ \n +/ +/", "+", "==", "(", ")", ";", "\t", "\xC3\xA9",
+};
+
+#define NUM_PIECES (sizeof(pieces) / sizeof(pieces[0]))
+
+static size_t MakeSource(char *out, size_t max)
+{
+	size_t len = 0;
+	
+	while(len + 16 < max)
+	{
+		const char *piece = pieces[Random(NUM_PIECES)];
+		
+		memcpy(out + len, piece, strlen(piece));
+		len += strlen(piece);
+	}
+	
+	return len;
+}
+
+/*
+ * Checking
+ */
+
+// Fed tokens never point into the source, so the text is compared through
+// LT_TokenString.
+static int SameToken(LT_Context *ctxA, LT_Token *a, LT_Context *ctxB, LT_Token *b)
+{
+	const char *textA, *textB;
+	
+	if(a->kind != b->kind || a->pos != b->pos || a->line != b->line || a->col != b->col ||
+		a->numType != b->numType || a->suffixLen != b->suffixLen || a->intValue != b->intValue ||
+		a->floatValue != b->floatValue || (a->symbol == 0) != (b->symbol == 0))
+	{
+		return 0;
+	}
+	
+	if(a->symbol != 0 && strcmp(LT_SymbolNameCtx(ctxA, a->symbol), LT_SymbolNameCtx(ctxB, b->symbol)) != 0)
+	{
+		return 0;
+	}
+	
+	textA = LT_TokenStringCtx(ctxA, a);
+	textB = LT_TokenStringCtx(ctxB, b);
+	
+	return (textA == NULL) == (textB == NULL) && (textA == NULL || strcmp(textA, textB) == 0);
+}
+
+// Errors raised by a token that's started again once more is fed are taken
+// back, but they've already pushed the oldest ones out of the ring. So the
+// fed errors only have to be the newest of the others, and as many raised.
+static int SameErrors(LT_Context *fed, LT_Context *memory)
+{
+	LT_ErrorInfo a[MAX_ERRORS], b[MAX_ERRORS];
+	size_t count = LT_GetErrorsCtx(fed, a, MAX_ERRORS), total = LT_GetErrorsCtx(memory, b, MAX_ERRORS), i;
+	const LT_ErrorInfo *newest;
+	
+	if(count > total || LT_GetStatsCtx(fed).asserts != LT_GetStatsCtx(memory).asserts)
+	{
+		return 0;
+	}
+	
+	newest = b + total - count;
+	
+	for(i = 0; i < count; i++)
+	{
+		if(a[i].code != newest[i].code || a[i].offset != newest[i].offset || a[i].line != newest[i].line ||
+			a[i].col != newest[i].col || a[i].arg != newest[i].arg)
+		{
+			return 0;
+		}
+	}
+	
+	return 1;
+}
+
+// Feeds the source a piece at a time, reading every token each piece
+// finishes. Returns the index of the first token that differs, -2 if the
+// errors do, or -1.
+static long Compare(LT_Config cfg, const char *src, size_t len)
+{
+	LT_Context *fed = LT_CreateContext(cfg), *memory = LT_CreateContext(cfg);
+	char piece[MAX_PIECE];
+	size_t offset = 0;
+	long count = 0, bad = -1;
+	LT_BOOL done = LT_FALSE;
+	
+	LT_OpenMemoryCtx(memory, src, len);
+	
+	while(!done && bad < 0)
+	{
+		size_t n = 1 + Random(MAX_PIECE);
+		
+		if(n > len - offset)
+		{
+			n = len - offset;
+		}
+		
+		// The piece is scribbled over once it's fed, since it shouldn't be
+		// needed after that.
+		memcpy(piece, src + offset, n);
+		LT_FeedCtx(fed, piece, n, offset + n == len);
+		memset(piece, 'Z', n);
+		offset += n;
+		
+		for(;;)
+		{
+			LT_Token have = LT_GetTokenCtx(fed), want;
+			
+			if(have.kind == TOK_EOF && LT_NeedsInputCtx(fed))
+			{
+				break;
+			}
+			
+			want = LT_GetTokenCtx(memory);
+			
+			if(!SameToken(fed, &have, memory, &want))
+			{
+				bad = count;
+				break;
+			}
+			
+			count++;
+			
+			if(want.kind == TOK_EOF)
+			{
+				done = LT_TRUE;
+				break;
+			}
+		}
+	}
+	
+	if(bad < 0 && !SameErrors(fed, memory))
+	{
+		bad = -2;
+	}
+	
+	LT_DestroyContext(fed);
+	LT_DestroyContext(memory);
+	return bad;
+}
+
+static int Run(const char *name, LT_Config cfg, const char *src, size_t len)
+{
+	long bad = Compare(cfg, src, len);
+	
+	if(bad == -2)
+	{
+		printf("%s: errors differ\n", name);
+	}
+	else if(bad >= 0)
+	{
+		printf("%s: differs at token %ld\n", name, bad);
+	}
+	
+	printf("%s\t%s\n", name, bad == -1 ? "same" : "differs");
+	return bad != -1;
+}
+
+int main(void)
+{
+	static const char *const keywords[] = { "if", "while", NULL };
+	static char src[SOURCE_LEN];
+	size_t len = MakeSource(src, sizeof(src));
+	LT_Config cfg;
+	int failed = 0;
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.escapeChars = LT_TRUE;
+	failed |= Run("plain", cfg, src, len);
+	
+	cfg.spanTokens = LT_TRUE;
+	cfg.parseNumbers = LT_TRUE;
+	failed |= Run("numbers", cfg, src, len);
+	
+	cfg.internIdents = LT_TRUE;
+	cfg.keywords = keywords;
+	failed |= Run("symbols", cfg, src, len);
+	
+	cfg.skipComments = LT_TRUE;
+	cfg.commentSpans = LT_TRUE;
+	failed |= Run("comments", cfg, src, len);
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.escapeChars = LT_TRUE;
+	cfg.stripInvalid = LT_TRUE;
+	failed |= Run("strip", cfg, src, len);
+	
+	return failed;
+}
@@ -0,0 +1,167 @@
+// Checks that keywords from the config come back as TOK_Keywrd + their
+// index, and that words that only look like them stay identifiers, for
+// small and large sets of keywords.
+
+#include "lt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_KEYWORDS 20000
+#define SOURCE_LEN (1 << 18)
+
+static unsigned rngState = 2463534242u;
+
+static unsigned Random(unsigned n)
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState % n;
+}
+
+static char words[MAX_KEYWORDS][16];
+static const char *keywords[MAX_KEYWORDS + 2];
+
+/*
+ * Sources
+ */
+
+// Keywords are k0, k1... and the first is listed again at the end, which
+// should keep its first index. Non-keywords are the same with something
+// added or in another case.
+static void MakeKeywords(unsigned count)
+{
+	unsigned i;
+	
+	for(i = 0; i < count; i++)
+	{
+		snprintf(words[i], sizeof(words[i]), "k%u", i);
+		keywords[i] = words[i];
+	}
+	
+	keywords[count] = words[0];
+	keywords[count + 1] = NULL;
+}
+
+// Writes words picked at random, keyword or not, and what each should lex
+// as to kinds.
+static size_t MakeSource(char *out, size_t max, unsigned count, int *kinds, size_t *numWords)
+{
+	size_t len = 0;
+	
+	*numWords = 0;
+	
+	while(len + 32 < max)
+	{
+		unsigned word = Random(count);
+		
+		switch(Random(5))
+		{
+		case 0:
+			len += (size_t)sprintf(out + len, "%sx ", words[word]);
+			kinds[(*numWords)++] = TOK_Identi;
+			break;
+		case 1:
+			len += (size_t)sprintf(out + len, "_%s\n", words[word]);
+			kinds[(*numWords)++] = TOK_Identi;
+			break;
+		case 2:
+			len += (size_t)sprintf(out + len, "K%s(", words[word] + 1);
+			kinds[(*numWords)++] = TOK_Identi;
+			break;
+		default:
+			len += (size_t)sprintf(out + len, "%s+", words[word]);
+			kinds[(*numWords)++] = TOK_Keywrd + (int)word;
+			break;
+		}
+	}
+	
+	return len;
+}
+
+/*
+ * Checking
+ */
+
+// Returns how many words lexed as the wrong thing.
+static unsigned Lex(LT_Context *ctx, const char *src, size_t len, const int *kinds, size_t numWords)
+{
+	unsigned failures = 0;
+	size_t i = 0;
+	LT_Token tk;
+	
+	LT_OpenMemoryCtx(ctx, src, len);
+	
+	while((tk = LT_GetTokenCtx(ctx)).kind != TOK_EOF)
+	{
+		if(tk.kind != TOK_Identi && tk.kind < TOK_Keywrd)
+		{
+			continue;
+		}
+		
+		if(i >= numWords || tk.kind != kinds[i] ||
+			(tk.kind >= TOK_Keywrd && (strcmp(tk.token, words[tk.kind - TOK_Keywrd]) != 0 || tk.string != tk.token ||
+			tk.strlen != strlen(tk.token) || tk.symbol != 0)))
+		{
+			if(failures++ == 0)
+			{
+				printf("word %lu at %d is kind %d, \"%s\"\n", (unsigned long)i, tk.pos, tk.kind, tk.token);
+			}
+		}
+		
+		i++;
+	}
+	
+	return failures + (i != numWords);
+}
+
+static int Run(unsigned count, LT_Config cfg)
+{
+	static char src[SOURCE_LEN];
+	static int kinds[SOURCE_LEN / 2];
+	size_t len, numWords;
+	LT_Context *ctx;
+	unsigned failures;
+	
+	MakeKeywords(count);
+	len = MakeSource(src, sizeof(src), count, kinds, &numWords);
+	
+	cfg.keywords = keywords;
+	ctx = LT_CreateContext(cfg);
+	
+	// The keywords are copied, so changing the list afterwards does nothing.
+	keywords[0] = "changed";
+	failures = Lex(ctx, src, len, kinds, numWords);
+	failures += LT_CheckAssertCtx(ctx).failure;
+	
+	LT_DestroyContext(ctx);
+	
+	printf("%u keywords%s\t%u wrong\n", count, cfg.spanTokens ? ", spans" : "", failures);
+	return failures != 0;
+}
+
+int main(void)
+{
+	static const unsigned counts[] = { 1, 7, 300, MAX_KEYWORDS };
+	LT_Config cfg;
+	int failed = 0;
+	size_t i;
+	
+	memset(&cfg, 0, sizeof(cfg));
+	
+	for(i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+	{
+		cfg.spanTokens = LT_FALSE;
+		cfg.internIdents = LT_FALSE;
+		failed |= Run(counts[i], cfg);
+		
+		// Keywords aren't interned, even with spans.
+		cfg.spanTokens = LT_TRUE;
+		cfg.internIdents = LT_TRUE;
+		failed |= Run(counts[i], cfg);
+	}
+	
+	return failed;
+}
@@ -0,0 +1,422 @@
+// Checks what happens when a context runs into its memLimit: tokens fail as
+// TOK_EOF and come back once strings are released, sources that won't fit
+// fail to open or be fed, and LT_TokenizeParallel either gives every token
+// or NULL, all raising LT_ERR_MEMORY. Takes a directory to write its files
+// into.
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "lt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#define SOURCE_LEN (1 << 18)
+#define BIG_LEN (256 * 1024)
+#define LIMIT (64 * 1024)
+#define BATCH 64
+
+static unsigned rngState = 2463534242u;
+
+static unsigned Random(unsigned n)
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState % n;
+}
+
+static const char *dir = ".";
+
+/*
+ * Sources
+ */
+
+// No newlines, so that the line index stays small.
+static size_t MakeSource(char *out, size_t max)
+{
+	size_t len = 0;
+	
+	while(len + 32 < max)
+	{
+		len += (size_t)sprintf(out + len, Random(4) == 0 ? "\"str%u\" " : "name%u + ", Random(100000));
+	}
+	
+	return len;
+}
+
+// A string literal bigger than the limit between two identifiers, with an
+// invalid byte in it for stripping.
+static size_t MakeBigString(char *out)
+{
+	memcpy(out, "a \"", 3);
+	memset(out + 3, 'x', BIG_LEN);
+	out[3 + BIG_LEN / 2] = '\xFF';
+	memcpy(out + 3 + BIG_LEN, "\" b", 3);
+	return BIG_LEN + 6;
+}
+
+static const char *PathTo(const char *name)
+{
+	static char path[1024];
+	
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	return path;
+}
+
+static int WriteFile(const char *path, const char *data, size_t len)
+{
+	FILE *fp = fopen(path, "wb");
+	
+	if(fp == NULL)
+	{
+		return 0;
+	}
+	
+	fwrite(data, 1, len, fp);
+	return fclose(fp) == 0;
+}
+
+/*
+ * Checking
+ */
+
+// The newest error's code, or LT_ERR_NONE.
+static int LastError(LT_Context *ctx)
+{
+	LT_ErrorInfo err;
+	
+	return LT_GetErrorsCtx(ctx, &err, 1) != 0 ? err.code : LT_ERR_NONE;
+}
+
+static int SameToken(LT_Context *ctxA, LT_Token *a, LT_Context *ctxB, LT_Token *b)
+{
+	const char *textA, *textB;
+	
+	if(a->kind != b->kind || a->pos != b->pos || a->strlen != b->strlen)
+	{
+		return 0;
+	}
+	
+	textA = LT_TokenStringCtx(ctxA, a);
+	textB = LT_TokenStringCtx(ctxB, b);
+	
+	return (textA == NULL) == (textB == NULL) && (textA == NULL || memcmp(textA, textB, a->strlen) == 0);
+}
+
+static int Check(const char *name, unsigned failures)
+{
+	printf("%s\t%u wrong\n", name, failures);
+	return failures != 0;
+}
+
+// Hands out tokens one at a time, read in batches with LT_GetTokens if batch
+// is set. A batch always ends with TOK_EOF, so one source's batches are
+// used up before the next's.
+static LT_Token Next(LT_Context *ctx, LT_BOOL batch)
+{
+	static LT_Token tokens[BATCH];
+	static size_t count, next;
+	
+	if(!batch)
+	{
+		return LT_GetTokenCtx(ctx);
+	}
+	
+	if(next == count)
+	{
+		count = LT_GetTokensCtx(ctx, tokens, BATCH);
+		next = 0;
+	}
+	
+	return tokens[next++];
+}
+
+// Lexes the source with and without the limit. A token that fails has to
+// come back as TOK_EOF between the last token and the one that should be
+// next, which is what lexing it again gives once strings are released.
+// Returns how many tokens failed, or -1 if something was wrong.
+static long Retry(LT_Config cfg, LT_BOOL batch, const char *src, size_t len)
+{
+	LT_Context *unlimited = LT_CreateContext(cfg), *limited;
+	long retries = 0, last = -1;
+	LT_Token want, have;
+	
+	cfg.memLimit = LIMIT;
+	limited = LT_CreateContext(cfg);
+	
+	LT_OpenMemoryCtx(unlimited, src, len);
+	LT_OpenMemoryCtx(limited, src, len);
+	
+	do
+	{
+		want = LT_GetTokenCtx(unlimited);
+		have = Next(limited, batch);
+		
+		if(have.kind == TOK_EOF && (size_t)have.pos != len)
+		{
+			if(have.pos <= last || have.pos > want.pos || LastError(limited) != LT_ERR_MEMORY)
+			{
+				retries = -1;
+				break;
+			}
+			
+			LT_ReleaseStringsCtx(limited);
+			have = Next(limited, batch);
+			retries++;
+		}
+		
+		if(!SameToken(limited, &have, unlimited, &want))
+		{
+			retries = -1;
+			break;
+		}
+		
+		last = want.pos;
+	}
+	while(want.kind != TOK_EOF);
+	
+	LT_DestroyContext(unlimited);
+	LT_DestroyContext(limited);
+	return retries;
+}
+
+static int CheckRetries(const char *src, size_t len)
+{
+	LT_Config cfg;
+	long copies, batches, spans;
+	
+	// Copied strings run out many times over, while spans need nothing.
+	memset(&cfg, 0, sizeof(cfg));
+	copies = Retry(cfg, LT_FALSE, src, len);
+	batches = Retry(cfg, LT_TRUE, src, len);
+	
+	cfg.spanTokens = LT_TRUE;
+	spans = Retry(cfg, LT_FALSE, src, len);
+	
+	printf("%ld copied, %ld batched and %ld span tokens failed and were lexed again\n", copies, batches, spans);
+	return Check("retries", (copies <= 0) + (batches != copies) + (spans != 0));
+}
+
+// A token bigger than the limit keeps failing at the same place.
+static int CheckTooBig(const char *big, size_t len)
+{
+	LT_Config cfg;
+	LT_Context *ctx;
+	LT_Token tk;
+	unsigned failures = 0;
+	int i;
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.memLimit = LIMIT;
+	ctx = LT_CreateContext(cfg);
+	
+	LT_OpenMemoryCtx(ctx, big, len);
+	tk = LT_GetTokenCtx(ctx);
+	failures += tk.kind != TOK_Identi;
+	
+	for(i = 0; i < 2; i++)
+	{
+		tk = LT_GetTokenCtx(ctx);
+		failures += tk.kind != TOK_EOF || tk.pos != 1 || LastError(ctx) != LT_ERR_MEMORY;
+		LT_ReleaseStringsCtx(ctx);
+	}
+	
+	LT_DestroyContext(ctx);
+	return Check("too big", failures);
+}
+
+#ifndef _WIN32
+// Opens a FIFO another process writes the source into, which has to be read
+// whole to be stripped.
+static int OpenPipe(LT_Context *ctx, const char *src, size_t len)
+{
+	const char *path = PathTo("memory.fifo");
+	int opened;
+	pid_t pid;
+	
+	unlink(path);
+	
+	if(mkfifo(path, 0600) != 0 || (pid = fork()) < 0)
+	{
+		return -1;
+	}
+	
+	if(pid == 0)
+	{
+		int fd = open(path, O_WRONLY);
+		
+		while(fd >= 0 && len != 0)
+		{
+			ssize_t n = write(fd, src, len);
+			
+			if(n <= 0)
+			{
+				break;
+			}
+			
+			src += n;
+			len -= (size_t)n;
+		}
+		
+		_exit(0);
+	}
+	
+	opened = LT_OpenFileCtx(ctx, path);
+	
+	// The reader gives up partway, so the writer may be stuck.
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	unlink(path);
+	return opened;
+}
+#endif
+
+// Sources copied to be stripped or read whole count against the limit, and
+// mapped ones don't.
+static int CheckSources(const char *big, size_t len)
+{
+	const char *path = PathTo("memory.txt");
+	LT_Config cfg;
+	LT_Context *ctx;
+	unsigned failures = 0;
+	
+	if(!WriteFile(path, big, len))
+	{
+		printf("can't write files in %s\n", dir);
+		return 1;
+	}
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.memLimit = LIMIT;
+	cfg.mapFiles = LT_TRUE;
+	ctx = LT_CreateContext(cfg);
+	failures += !LT_OpenFileCtx(ctx, path) || LastError(ctx) != LT_ERR_NONE;
+	LT_DestroyContext(ctx);
+	
+	cfg.mapFiles = LT_FALSE;
+	cfg.stripInvalid = LT_TRUE;
+	ctx = LT_CreateContext(cfg);
+	
+	failures += LT_OpenFileCtx(ctx, path) || LastError(ctx) != LT_ERR_MEMORY;
+	LT_ClearErrorsCtx(ctx);
+	
+	failures += LT_OpenMemoryCtx(ctx, big, len) || LastError(ctx) != LT_ERR_MEMORY;
+	LT_ClearErrorsCtx(ctx);
+	
+	// PathTo's buffer is used again for the FIFO.
+	remove(path);
+	
+#ifndef _WIN32
+	failures += OpenPipe(ctx, big, len) != 0 || LastError(ctx) != LT_ERR_MEMORY;
+#endif
+	
+	LT_DestroyContext(ctx);
+	return Check("sources", failures);
+}
+
+// Fed data is held until its tokens are finished, so the big string can't
+// be fed in one go.
+static int CheckFeed(const char *big, size_t len)
+{
+	LT_Config cfg;
+	LT_Context *ctx;
+	unsigned failures;
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.memLimit = LIMIT;
+	ctx = LT_CreateContext(cfg);
+	
+	failures = LT_FeedCtx(ctx, big, len, LT_TRUE) || LastError(ctx) != LT_ERR_MEMORY;
+	
+	LT_DestroyContext(ctx);
+	return Check("feed", failures);
+}
+
+// Under a range of limits, lexing in parallel has to give every token or
+// NULL. Workers get a share of the limit each, so some of them run out
+// even when the whole source fits.
+static int CheckParallel(const char *src, size_t len)
+{
+	size_t want, have, limit, i;
+	unsigned failures = 0, fits = 0, tries = 0;
+	LT_Config cfg;
+	LT_Context *unlimited;
+	LT_Token *wantTokens;
+	
+	memset(&cfg, 0, sizeof(cfg));
+	unlimited = LT_CreateContext(cfg);
+	LT_OpenMemoryCtx(unlimited, src, len);
+	wantTokens = LT_TokenizeParallelCtx(unlimited, 1, &want);
+	
+	for(limit = 16 * 1024; limit <= (size_t)32 << 20; limit += limit / 4)
+	{
+		LT_Context *ctx;
+		LT_Token *tokens;
+		
+		cfg.memLimit = limit;
+		ctx = LT_CreateContext(cfg);
+		LT_OpenMemoryCtx(ctx, src, len);
+		tokens = LT_TokenizeParallelCtx(ctx, 4, &have);
+		tries++;
+		
+		if(tokens == NULL)
+		{
+			failures += LastError(ctx) != LT_ERR_MEMORY;
+		}
+		else
+		{
+			fits++;
+			failures += have != want;
+			
+			for(i = 0; i < have && i < want; i++)
+			{
+				if(!SameToken(ctx, &tokens[i], unlimited, &wantTokens[i]))
+				{
+					failures++;
+					break;
+				}
+			}
+		}
+		
+		LT_DestroyContext(ctx);
+	}
+	
+	LT_DestroyContext(unlimited);
+	
+	printf("parallel lexing fit under %u of %u limits\n", fits, tries);
+	return Check("parallel", failures + (fits == 0 || fits == tries));
+}
+
+int main(int argc, char **argv)
+{
+	static char src[SOURCE_LEN], big[BIG_LEN + 6];
+	size_t len = MakeSource(src, sizeof(src)), bigLen = MakeBigString(big);
+	int failed = 0;
+	
+	if(argc > 1)
+	{
+		dir = argv[1];
+	}
+	
+	failed |= CheckRetries(src, len);
+	failed |= CheckTooBig(big, bigLen);
+	failed |= CheckSources(big, bigLen);
+	failed |= CheckFeed(big, bigLen);
+	
+	failed |= CheckParallel(src, len);
+	
+	return failed;
+}
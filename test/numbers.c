@@ -0,0 +1,143 @@
+// Checks the values parseNumbers gives number tokens, read from memory with
+// and without spans and fed a byte at a time.
+
+#include "lt.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+	const char *text;
+	int numType;
+	unsigned long long intValue;
+	double floatValue;
+	unsigned suffixLen;
+} NumberCase;
+
+static const NumberCase cases[] = {
+	{ "0",                    LT_NUM_INT,   0,          0,      0 },
+	{ "42",                   LT_NUM_INT,   42,         42,     0 },
+	{ "0x1F",                 LT_NUM_INT,   31,         31,     0 },
+	{ "0XfF",                 LT_NUM_INT,   255,        255,    0 },
+	{ "0b101",                LT_NUM_INT,   5,          5,      0 },
+	{ "0o17",                 LT_NUM_INT,   15,         15,     0 },
+	{ "017",                  LT_NUM_INT,   15,         15,     0 },
+	{ "18446744073709551615", LT_NUM_INT,   ULLONG_MAX, 0,      0 },
+	{ "10u",                  LT_NUM_INT,   10,         10,     1 },
+	{ "10ULL",                LT_NUM_INT,   10,         10,     3 },
+	{ "123abc",               LT_NUM_INT,   123,        123,    3 },
+	{ "0x10zu",               LT_NUM_INT,   16,         16,     2 },
+	{ "1.5",                  LT_NUM_FLOAT, 0,          1.5,    0 },
+	{ "1.",                   LT_NUM_FLOAT, 0,          1,      0 },
+	{ "1e-5",                 LT_NUM_FLOAT, 0,          1e-5,   0 },
+	{ "1E+3",                 LT_NUM_FLOAT, 0,          1000,   0 },
+	{ "2.5e3f",               LT_NUM_FLOAT, 0,          2500,   1 },
+	{ "0x1p4",                LT_NUM_FLOAT, 0,          16,     0 },
+	{ "0x1.8p1",              LT_NUM_FLOAT, 0,          3,      0 },
+	{ "0x1P-2L",              LT_NUM_FLOAT, 0,          0.25,   1 },
+	{ "08",                   LT_NUM_BAD,   0,          0,      0 },
+	{ "0b12",                 LT_NUM_BAD,   0,          0,      0 },
+	{ "0o8",                  LT_NUM_BAD,   0,          0,      0 },
+	{ "0x",                   LT_NUM_BAD,   0,          0,      0 },
+	{ "0x1.8",                LT_NUM_BAD,   0,          0,      0 },
+	{ "18446744073709551616", LT_NUM_BAD,   0,          0,      0 },
+	{ "1e400",                LT_NUM_BAD,   0,          0,      0 },
+	{ "1e+",                  LT_NUM_BAD,   0,          0,      0 },
+	{ "1u2",                  LT_NUM_BAD,   0,          0,      0 },
+};
+
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+
+/*
+ * Checking
+ */
+
+static int CheckToken(const NumberCase *want, const LT_Token *tk)
+{
+	if(tk->kind != TOK_Number || tk->numType != want->numType || tk->pos != 0 || tk->spanLen != strlen(want->text))
+	{
+		return 0;
+	}
+	
+	switch(want->numType)
+	{
+	case LT_NUM_INT:
+		return tk->intValue == want->intValue && tk->floatValue == (double)want->intValue &&
+			tk->suffixLen == want->suffixLen;
+	case LT_NUM_FLOAT:
+		return tk->floatValue == want->floatValue && tk->suffixLen == want->suffixLen;
+	}
+	
+	return 1;
+}
+
+// Lexes the case followed by a space, from memory or fed a byte at a time.
+static LT_Token Lex(LT_Context *ctx, const char *text, LT_BOOL feed)
+{
+	char src[64];
+	size_t len = (size_t)sprintf(src, "%s ", text), i;
+	LT_Token tk;
+	
+	if(!feed)
+	{
+		LT_OpenMemoryCtx(ctx, src, len);
+		return LT_GetTokenCtx(ctx);
+	}
+	
+	LT_CloseFileCtx(ctx);
+	
+	for(i = 0; i < len; i++)
+	{
+		LT_FeedCtx(ctx, src + i, 1, i + 1 == len);
+		
+		if((tk = LT_GetTokenCtx(ctx)).kind != TOK_EOF || !LT_NeedsInputCtx(ctx))
+		{
+			return tk;
+		}
+	}
+	
+	return tk;
+}
+
+static int Run(const char *name, LT_Config cfg, LT_BOOL feed)
+{
+	LT_Context *ctx = LT_CreateContext(cfg);
+	unsigned failures = 0;
+	size_t i;
+	
+	for(i = 0; i < NUM_CASES; i++)
+	{
+		LT_Token tk = Lex(ctx, cases[i].text, feed);
+		
+		if(!CheckToken(&cases[i], &tk))
+		{
+			failures++;
+			printf("%s: \"%s\" is kind %d, numType %d, %llu, %g, suffix %u, length %u\n", name, cases[i].text,
+				tk.kind, tk.numType, tk.intValue, tk.floatValue, tk.suffixLen, tk.spanLen);
+		}
+	}
+	
+	LT_DestroyContext(ctx);
+	
+	printf("%s\t%u/%u numbers wrong\n", name, failures, (unsigned)NUM_CASES);
+	return failures != 0;
+}
+
+int main(void)
+{
+	LT_Config cfg;
+	int failed = 0;
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.parseNumbers = LT_TRUE;
+	failed |= Run("plain", cfg, LT_FALSE);
+	failed |= Run("fed", cfg, LT_TRUE);
+	
+	cfg.spanTokens = LT_TRUE;
+	failed |= Run("spans", cfg, LT_FALSE);
+	
+	return failed;
+}
@@ -0,0 +1,268 @@
+// Checks that LT_OpenFile gives the same tokens as LT_OpenMemory on the same
+// bytes, for plain files, empty ones and pipes, however the file is read.
+// Takes a directory to write its files into.
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "lt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+// Bigger than a pipe's buffer, so a pipe's writer has to wait on the reader.
+#define SOURCE_LEN (200 * 1024)
+
+static const char *dir = ".";
+
+/*
+ * Sources
+ */
+
+static size_t MakeSource(char *out, size_t max)
+{
+	static const char line[] = "ident = 0x1F + 1.5e3; \"str\\n\" 'c' caf\xE9 // comment\n";
+	size_t len = 0;
+	
+	while(len + sizeof(line) < max)
+	{
+		memcpy(out + len, line, sizeof(line) - 1);
+		len += sizeof(line) - 1;
+	}
+	
+	return len;
+}
+
+static const char *PathTo(const char *name)
+{
+	static char path[1024];
+	
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	return path;
+}
+
+static int WriteFile(const char *path, const char *data, size_t len)
+{
+	FILE *fp = fopen(path, "wb");
+	
+	if(fp == NULL)
+	{
+		return 0;
+	}
+	
+	fwrite(data, 1, len, fp);
+	return fclose(fp) == 0;
+}
+
+/*
+ * Checking
+ */
+
+static int SameToken(const LT_Token *a, const LT_Token *b)
+{
+	if(a->kind != b->kind || a->pos != b->pos || a->line != b->line || a->col != b->col ||
+		a->strlen != b->strlen || (a->string == NULL) != (b->string == NULL))
+	{
+		return 0;
+	}
+	
+	return a->string == NULL || memcmp(a->string, b->string, a->strlen) == 0;
+}
+
+// Lexes the file and the memory side by side. Returns the number of tokens
+// that were the same, or -1 if one differed or the file didn't open.
+static long Compare(const char *path, LT_Config cfg, const char *src, size_t len)
+{
+	LT_Context *file = LT_CreateContext(cfg), *memory = LT_CreateContext(cfg);
+	long same = -1;
+	
+	if(LT_OpenFileCtx(file, path) && LT_OpenMemoryCtx(memory, src, len))
+	{
+		for(same = 0;; same++)
+		{
+			LT_Token have = LT_GetTokenCtx(file), want = LT_GetTokenCtx(memory);
+			
+			if(!SameToken(&have, &want))
+			{
+				same = -1;
+				break;
+			}
+			
+			if(want.kind == TOK_EOF)
+			{
+				break;
+			}
+		}
+	}
+	
+	LT_DestroyContext(file);
+	LT_DestroyContext(memory);
+	return same;
+}
+
+static int Check(const char *name, long same)
+{
+	printf("%s\t%s\n", name, same < 0 ? "differs" : "same");
+	return same < 0;
+}
+
+#ifndef _WIN32
+// Writes the source into a FIFO from another process while it's lexed.
+static long ComparePipe(LT_Config cfg, const char *src, size_t len)
+{
+	const char *path = PathTo("open.fifo");
+	long same;
+	pid_t pid;
+	
+	unlink(path);
+	
+	if(mkfifo(path, 0600) != 0 || (pid = fork()) < 0)
+	{
+		return -1;
+	}
+	
+	if(pid == 0)
+	{
+		int fd = open(path, O_WRONLY);
+		
+		while(fd >= 0 && len != 0)
+		{
+			ssize_t n = write(fd, src, len);
+			
+			if(n <= 0)
+			{
+				break;
+			}
+			
+			src += n;
+			len -= (size_t)n;
+		}
+		
+		_exit(0);
+	}
+	
+	same = Compare(path, cfg, src, len);
+	
+	// If the file was never opened, the writer is still waiting for it.
+	if(same < 0)
+	{
+		kill(pid, SIGKILL);
+	}
+	
+	waitpid(pid, NULL, 0);
+	unlink(path);
+	return same;
+}
+#endif
+
+static int Run(const char *name, LT_Config cfg, LT_BOOL pipes, const char *src, size_t len)
+{
+	char label[64];
+	int failed = 0;
+	
+	snprintf(label, sizeof(label), "%s file", name);
+	failed |= Check(label, Compare(PathTo("open.txt"), cfg, src, len));
+	
+	snprintf(label, sizeof(label), "%s empty", name);
+	failed |= Check(label, Compare(PathTo("open.empty"), cfg, "", 0));
+	
+#ifndef _WIN32
+	// Read through stdio, a pipe has no positions to give tokens.
+	if(pipes)
+	{
+		snprintf(label, sizeof(label), "%s pipe", name);
+		failed |= Check(label, ComparePipe(cfg, src, len));
+	}
+#endif
+	
+	return failed;
+}
+
+#ifndef LT_NO_ICONV
+// The config's encodings are copied, so the caller's can change once it's
+// set. A BOM switches the converter, and the next source without one goes
+// back to the config's fromCode.
+static int CheckCopiedEncoding(void)
+{
+	char fromCode[16] = "ISO-8859-1";
+	const char *str;
+	LT_Config cfg;
+	LT_Context *ctx;
+	LT_Token tk;
+	long same;
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.doConvert = LT_TRUE;
+	cfg.fromCode = fromCode;
+	ctx = LT_CreateContext(cfg);
+	strcpy(fromCode, "no such code");
+	
+	LT_OpenMemoryCtx(ctx, "\xEF\xBB\xBF\"a\"", 6);
+	LT_GetTokenCtx(ctx);
+	
+	LT_OpenMemoryCtx(ctx, "\"\xE9\"", 3);
+	tk = LT_GetTokenCtx(ctx);
+	str = LT_TokenStringCtx(ctx, &tk);
+	same = tk.kind == TOK_String && str != NULL && strcmp(str, "\xC3\xA9") == 0 && !LT_CheckAssertCtx(ctx).failure ? 0 : -1;
+	
+	LT_DestroyContext(ctx);
+	return Check("converted copy", same);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+	static char src[SOURCE_LEN];
+	size_t len = MakeSource(src, sizeof(src));
+	LT_Config cfg;
+	int failed = 0;
+	
+	if(argc > 1)
+	{
+		dir = argv[1];
+	}
+	
+	if(!WriteFile(PathTo("open.txt"), src, len) || !WriteFile(PathTo("open.empty"), "", 0))
+	{
+		printf("can't write files in %s\n", dir);
+		return 1;
+	}
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.escapeChars = LT_TRUE;
+	failed |= Run("stdio", cfg, LT_FALSE, src, len);
+	
+	cfg.mapFiles = LT_TRUE;
+	failed |= Run("mapped", cfg, LT_TRUE, src, len);
+	
+#ifndef LT_NO_ICONV
+	// Converted files are read whole whether or not they're mapped.
+	cfg.mapFiles = LT_FALSE;
+	cfg.doConvert = LT_TRUE;
+	cfg.fromCode = "ISO-8859-1";
+	failed |= Run("converted", cfg, LT_TRUE, src, len);
+	failed |= CheckCopiedEncoding();
+	cfg.doConvert = LT_FALSE;
+	cfg.fromCode = NULL;
+#endif
+	
+	// So are stripped ones, and the source's lone 0xE9 is stripped.
+	cfg.mapFiles = LT_FALSE;
+	cfg.stripInvalid = LT_TRUE;
+	failed |= Run("stripped", cfg, LT_TRUE, src, len);
+	
+	remove(PathTo("open.txt"));
+	remove(PathTo("open.empty"));
+	return failed;
+}
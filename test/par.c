@@ -0,0 +1,205 @@
+// Checks that LT_TokenizeParallel gives the same tokens and errors as lexing
+// the same source one token at a time, under a few configs and thread counts.
+
+#include "lt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Big enough to be split into several chunks.
+#define SOURCE_LEN (1 << 20)
+#define MAX_ERRORS 64
+
+static unsigned rngState = 2463534242u;
+
+static unsigned Random(unsigned n)
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState % n;
+}
+
+/*
+ * Sources
+ */
+
+// Strings and comments with newlines in them make chunks start inside a
+// token, and the bad escapes and unterminated strings raise errors.
+static const char *const pieces[] = {
+	"ident", "if", "while", " ", "\n", "\n", "\n", "123", "0x1Fu", "1.5e-3f", "\"str\"", "\"esc\\n\"", "\"bad\\q\"",
+	"'c'", "\"two\nlines\"", "\"open\n", "/* a\n\"b\n*/", "// line \"\n", "/+ /+ \n +/ +/", "+", "==", "(", ")", ";",
+	"\t", "\xC3\xA9",
+};
+
+#define NUM_PIECES (sizeof(pieces) / sizeof(pieces[0]))
+
+static size_t MakeSource(char *out, size_t max)
+{
+	size_t len = 0;
+	
+	while(len + 16 < max)
+	{
+		const char *piece = pieces[Random(NUM_PIECES)];
+		
+		memcpy(out + len, piece, strlen(piece));
+		len += strlen(piece);
+	}
+	
+	return len;
+}
+
+/*
+ * Checking
+ */
+
+static int SameString(const char *a, const char *b, size_t len)
+{
+	return (a == NULL) == (b == NULL) && (a == NULL || memcmp(a, b, len) == 0);
+}
+
+// Symbol IDs may be handed out in a different order, so their names are
+// compared instead.
+static int SameToken(LT_Context *ctxA, const LT_Token *a, LT_Context *ctxB, const LT_Token *b)
+{
+	if(a->kind != b->kind || a->pos != b->pos || a->line != b->line || a->col != b->col ||
+		a->spanPos != b->spanPos || a->spanLen != b->spanLen || a->strlen != b->strlen ||
+		a->hasEscapes != b->hasEscapes || a->numType != b->numType || a->suffixLen != b->suffixLen ||
+		a->intValue != b->intValue || a->floatValue != b->floatValue || (a->symbol == 0) != (b->symbol == 0))
+	{
+		return 0;
+	}
+	
+	if(a->symbol != 0 && strcmp(LT_SymbolNameCtx(ctxA, a->symbol), LT_SymbolNameCtx(ctxB, b->symbol)) != 0)
+	{
+		return 0;
+	}
+	
+	return SameString(a->string, b->string, a->strlen);
+}
+
+static int SameErrors(LT_Context *ctxA, LT_Context *ctxB)
+{
+	LT_ErrorInfo a[MAX_ERRORS], b[MAX_ERRORS];
+	size_t count = LT_GetErrorsCtx(ctxA, a, MAX_ERRORS), i;
+	
+	if(count != LT_GetErrorsCtx(ctxB, b, MAX_ERRORS))
+	{
+		return 0;
+	}
+	
+	for(i = 0; i < count; i++)
+	{
+		if(a[i].code != b[i].code || a[i].offset != b[i].offset || a[i].line != b[i].line || a[i].col != b[i].col ||
+			a[i].arg != b[i].arg)
+		{
+			return 0;
+		}
+	}
+	
+	return 1;
+}
+
+// Returns the index of the first token that differs, -2 if the errors do,
+// or -1.
+static long Compare(LT_Config cfg, unsigned threads, const char *src, size_t len)
+{
+	LT_Context *serial = LT_CreateContext(cfg), *parallel = LT_CreateContext(cfg);
+	size_t count, cap = 1024, have = 0, i;
+	LT_Token *want = malloc(cap * sizeof(LT_Token)), *got;
+	long bad = -1;
+	
+	LT_OpenMemoryCtx(serial, src, len);
+	LT_OpenMemoryCtx(parallel, src, len);
+	
+	do
+	{
+		if(have == cap)
+		{
+			want = realloc(want, (cap *= 2) * sizeof(LT_Token));
+		}
+		
+		want[have] = LT_GetTokenCtx(serial);
+	}
+	while(want[have++].kind != TOK_EOF);
+	
+	got = LT_TokenizeParallelCtx(parallel, threads, &count);
+	
+	for(i = 0; got != NULL && i < count && i < have; i++)
+	{
+		if(!SameToken(serial, &want[i], parallel, &got[i]))
+		{
+			bad = (long)i;
+			break;
+		}
+	}
+	
+	if(bad < 0 && (got == NULL || count != have))
+	{
+		bad = got == NULL ? 0 : (long)(count < have ? count : have);
+	}
+	
+	if(bad < 0 && !SameErrors(serial, parallel))
+	{
+		bad = -2;
+	}
+	
+	free(want);
+	LT_DestroyContext(serial);
+	LT_DestroyContext(parallel);
+	return bad;
+}
+
+static int Run(const char *name, LT_Config cfg, const char *src, size_t len)
+{
+	static const unsigned threads[] = { 1, 2, 3, 8 };
+	unsigned i, failures = 0;
+	
+	for(i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+	{
+		long bad = Compare(cfg, threads[i], src, len);
+		
+		if(bad == -2)
+		{
+			printf("%s: %u threads: errors differ\n", name, threads[i]);
+		}
+		else if(bad >= 0)
+		{
+			printf("%s: %u threads: differs at token %ld\n", name, threads[i], bad);
+		}
+		
+		failures += bad != -1;
+	}
+	
+	printf("%s\t%u/%u thread counts differ\n", name, failures, i);
+	return failures != 0;
+}
+
+int main(void)
+{
+	static const char *const keywords[] = { "if", "while", NULL };
+	static char src[SOURCE_LEN];
+	size_t len = MakeSource(src, sizeof(src));
+	LT_Config cfg;
+	int failed = 0;
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.escapeChars = LT_TRUE;
+	failed |= Run("plain", cfg, src, len);
+	
+	cfg.spanTokens = LT_TRUE;
+	cfg.parseNumbers = LT_TRUE;
+	cfg.lazyEscapes = LT_TRUE;
+	failed |= Run("spans", cfg, src, len);
+	
+	cfg.internIdents = LT_TRUE;
+	cfg.keywords = keywords;
+	failed |= Run("symbols", cfg, src, len);
+	
+	cfg.skipComments = LT_TRUE;
+	cfg.commentSpans = LT_TRUE;
+	failed |= Run("comments", cfg, src, len);
+	
+	return failed;
+}
@@ -0,0 +1,166 @@
+// Checks that interned identifiers get one symbol ID and one string per
+// name, numbered from 1 as they're first seen, and that the IDs stay put
+// across LT_ReleaseStrings and new sources.
+
+#include "lt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAMES 5000
+#define SOURCE_LEN (1 << 18)
+
+static unsigned rngState = 2463534242u;
+
+static unsigned Random(unsigned n)
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState % n;
+}
+
+static char names[NAMES][16];
+
+// The symbol each name should have, or 0 if it hasn't been seen.
+static int expected[NAMES];
+static int symbolCount;
+
+/*
+ * Sources
+ */
+
+// Names are prefixes of each other as well as different, so that only
+// whole names match.
+static void MakeNames(void)
+{
+	int i;
+	
+	for(i = 0; i < NAMES; i++)
+	{
+		snprintf(names[i], sizeof(names[i]), i % 3 == 0 ? "v%d" : i % 3 == 1 ? "v%d_" : "_v%d", i / 3);
+	}
+}
+
+// Writes names picked at random, and the order they're in to order.
+static size_t MakeSource(char *out, size_t max, int *order, size_t *count)
+{
+	static const char *const gaps[] = { " ", "\n", " + ", "(", ")\t" };
+	size_t len = 0;
+	
+	*count = 0;
+	
+	while(len + 32 < max)
+	{
+		int name = (int)Random(NAMES);
+		const char *gap = gaps[Random(sizeof(gaps) / sizeof(gaps[0]))];
+		
+		order[(*count)++] = name;
+		len += (size_t)sprintf(out + len, "%s%s", names[name], gap);
+	}
+	
+	return len;
+}
+
+/*
+ * Checking
+ */
+
+static int CheckToken(LT_Context *ctx, const LT_Token *tk, int name)
+{
+	if(tk->kind != TOK_Identi || tk->symbol <= 0 || tk->string == NULL || strcmp(tk->string, names[name]) != 0 ||
+		tk->strlen != strlen(names[name]) || tk->string != LT_SymbolNameCtx(ctx, tk->symbol))
+	{
+		return 0;
+	}
+	
+	// A new name gets the next ID.
+	if(expected[name] == 0)
+	{
+		expected[name] = ++symbolCount;
+	}
+	
+	return tk->symbol == expected[name];
+}
+
+// Lexes a new source, returning how many identifiers were wrong.
+static unsigned Lex(LT_Context *ctx, const char *src, size_t len, const int *order, size_t count)
+{
+	unsigned failures = 0;
+	size_t i = 0;
+	LT_Token tk;
+	
+	LT_OpenMemoryCtx(ctx, src, len);
+	
+	while((tk = LT_GetTokenCtx(ctx)).kind != TOK_EOF)
+	{
+		if(tk.kind == TOK_Identi && (i >= count || !CheckToken(ctx, &tk, order[i++])))
+		{
+			if(failures++ == 0)
+			{
+				printf("identifier %lu at %d is \"%s\", symbol %d\n", (unsigned long)i, tk.pos,
+					tk.string != NULL ? tk.string : "", tk.symbol);
+			}
+		}
+	}
+	
+	return failures + (i != count);
+}
+
+static int Run(const char *name, LT_Config cfg, const char *src, size_t len, const int *order, size_t count)
+{
+	LT_Context *ctx = LT_CreateContext(cfg);
+	unsigned failures;
+	int i;
+	
+	memset(expected, 0, sizeof(expected));
+	symbolCount = 0;
+	
+	// Interning a name before it's lexed gives it its ID.
+	expected[1] = ++symbolCount;
+	failures = LT_InternCtx(ctx, names[1]) != expected[1];
+	
+	failures += Lex(ctx, src, len, order, count);
+	
+	// Strings are released, but symbols aren't.
+	LT_ReleaseStringsCtx(ctx);
+	failures += Lex(ctx, src, len, order, count);
+	
+	for(i = 0; i < NAMES; i++)
+	{
+		if(expected[i] != 0 && (LT_InternCtx(ctx, names[i]) != expected[i] ||
+			strcmp(LT_SymbolNameCtx(ctx, expected[i]), names[i]) != 0))
+		{
+			failures++;
+		}
+	}
+	
+	failures += LT_SymbolNameCtx(ctx, 0) != NULL || LT_SymbolNameCtx(ctx, symbolCount + 1) != NULL;
+	
+	LT_DestroyContext(ctx);
+	
+	printf("%s\t%u wrong, %d symbols\n", name, failures, symbolCount);
+	return failures != 0;
+}
+
+int main(void)
+{
+	static char src[SOURCE_LEN];
+	static int order[SOURCE_LEN / 2];
+	size_t len, count;
+	LT_Config cfg;
+	int failed = 0;
+	
+	MakeNames();
+	len = MakeSource(src, sizeof(src), order, &count);
+	
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.internIdents = LT_TRUE;
+	failed |= Run("interned", cfg, src, len, order, count);
+	
+	cfg.spanTokens = LT_TRUE;
+	failed |= Run("spans", cfg, src, len, order, count);
+	
+	return failed;
+}